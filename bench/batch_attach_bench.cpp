@@ -0,0 +1,101 @@
+// Cold-start attach time vs worker threads, against the emulated driver
+#include "batch_attach.h"
+#include "vmm_emulation.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char** argv) {
+    size_t buffers = 256;
+    uint64_t latency_us = 200;
+    int max_threads = 16;
+    bool bad_fd = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--buffers") == 0 && i + 1 < argc) {
+            buffers = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--latency-us") == 0 && i + 1 < argc) {
+            latency_us = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--max-threads") == 0 && i + 1 < argc) {
+            max_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--bad-fd") == 0) {
+            bad_fd = true;
+        } else {
+            fprintf(stderr, "Usage: %s [--buffers N] [--latency-us N] [--max-threads N] [--bad-fd]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    // 1. Emulated driver: latency on the per-buffer attach calls
+    VmmEmulationConfig config = defaultVmmEmulationConfig();
+    config.latency_ns[VMM_EMU_IMPORT] = latency_us * 1000;
+    config.latency_ns[VMM_EMU_MAP] = latency_us * 1000;
+    config.latency_ns[VMM_EMU_SET_ACCESS] = latency_us * 1000;
+    configureVmmEmulation(config);
+    const VmmDriver& driver = emulatedVmmDriver();
+
+    printf("=== Batch Attach Cold-Start Benchmark (%s driver) ===\n", driver.name);
+    printf("Buffers: %zu, injected latency: %llu us per import/map/set-access\n",
+           buffers, (unsigned long long)latency_us);
+
+    // 2. "Producer": export one FD per buffer
+    std::vector<CUmemGenericAllocationHandle> handles(buffers);
+    std::vector<BatchImportRequest> requests(buffers);
+    for (size_t i = 0; i < buffers; ++i) {
+        if (driver.memCreate(&handles[i], config.granularity, NULL, 0) != CUDA_SUCCESS ||
+            driver.memExportToShareableHandle(&requests[i].fd, handles[i],
+                CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR, 0) != CUDA_SUCCESS) {
+            fprintf(stderr, "Failed to create emulated buffer %zu\n", i);
+            return 1;
+        }
+        requests[i].size = config.granularity;
+    }
+    if (bad_fd) {
+        requests.push_back({-1, config.granularity});
+    }
+
+    // 3. Attach with increasing thread counts
+    VAArena arena;
+    if (arena.init(buffers * config.granularity * 2, config.granularity, driver) < 0) {
+        return 1;
+    }
+    BatchAttachOptions options = {};
+    options.access = CU_MEM_ACCESS_FLAGS_PROT_READ;
+    options.arena = &arena;
+
+    double baseline_ms = 0;
+    printf("%8s %12s %10s %8s\n", "threads", "attach_ms", "speedup", "failed");
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        options.num_threads = threads;
+        auto start = Clock::now();
+        std::vector<BatchImportResult> results = batchAttach(requests, options, driver);
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        if (threads == 1) {
+            baseline_ms = ms;
+        }
+
+        size_t failed = 0;
+        for (size_t i = 0; i < results.size(); ++i) {
+            if (results[i].status != CUDA_SUCCESS) {
+                if (failed++ == 0 && threads == 1) {
+                    printf("  buffer %zu failed in %s (error %d)\n",
+                           i, results[i].failed_stage, (int)results[i].status);
+                }
+            }
+        }
+        printf("%8d %12.1f %9.1fx %8zu\n", threads, ms, baseline_ms / ms, failed);
+        batchDetach(results, options, driver);
+    }
+
+    // 4. Cleanup
+    arena.destroy();
+    for (size_t i = 0; i < buffers; ++i) {
+        close(requests[i].fd);
+        driver.memRelease(handles[i]);
+    }
+    return 0;
+}
@@ -0,0 +1,131 @@
+// Reclaimed bytes and owner pause of CompactionPool::compact(), against
+// the emulated driver. Every allocation is checked after each pass through
+// its original pointer.
+#include "compaction_pool.h"
+#include "cuda_ipc_common.h"
+#include "vmm_emulation.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+struct LiveBuffer {
+    CUdeviceptr ptr;
+    size_t size;
+    uint32_t seed;
+};
+
+static bool verifyAll(const VmmDriver& driver, CompactionPool& pool,
+                      const std::vector<LiveBuffer>& buffers) {
+    auto access = pool.access();
+    for (const LiveBuffer& buffer : buffers) {
+        std::vector<int> host(buffer.size / sizeof(int));
+        driver.memcpyDtoH(host.data(), buffer.ptr, buffer.size);
+        if (!verifyTestData(host.data(), host.size(), buffer.seed)) {
+            fprintf(stderr, "Buffer at 0x%llx corrupted\n", (unsigned long long)buffer.ptr);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    size_t allocations = 256;
+    size_t max_granules = 4;
+    int free_percent = 50;
+    uint64_t latency_us = 20;
+    size_t segment_mb = 64;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--allocations") == 0 && i + 1 < argc) {
+            allocations = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--max-granules") == 0 && i + 1 < argc) {
+            max_granules = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--free-percent") == 0 && i + 1 < argc) {
+            free_percent = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--latency-us") == 0 && i + 1 < argc) {
+            latency_us = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--segment-mb") == 0 && i + 1 < argc) {
+            segment_mb = strtoul(argv[++i], NULL, 10);
+        } else {
+            fprintf(stderr, "Usage: %s [--allocations N] [--max-granules N] [--free-percent N] "
+                    "[--latency-us N] [--segment-mb N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    // 1. Emulated driver with latency on the calls compaction issues
+    VmmEmulationConfig config = defaultVmmEmulationConfig();
+    config.latency_ns[VMM_EMU_CREATE] = latency_us * 1000;
+    config.latency_ns[VMM_EMU_MAP] = latency_us * 1000;
+    config.latency_ns[VMM_EMU_UNMAP] = latency_us * 1000;
+    config.latency_ns[VMM_EMU_SET_ACCESS] = latency_us * 1000;
+    configureVmmEmulation(config);
+    const VmmDriver& driver = emulatedVmmDriver();
+
+    printf("=== Compaction Benchmark (%s driver) ===\n", driver.name);
+    printf("Allocations: %zu of 1-%zu granules, free %d%%, segment %zu MB, latency %llu us\n",
+           allocations, max_granules, free_percent, segment_mb, (unsigned long long)latency_us);
+
+    CompactionPool pool;
+    if (pool.init(0, config.granularity, driver, segment_mb << 20) != 0) {
+        return 1;
+    }
+
+    // 2. Many small handles, each filled with its own pattern
+    std::mt19937 rng(42);
+    std::vector<LiveBuffer> buffers;
+    for (size_t i = 0; i < allocations; ++i) {
+        size_t size = (1 + rng() % max_granules) * config.granularity;
+        CUdeviceptr ptr = pool.allocate(size);
+        if (!ptr) {
+            fprintf(stderr, "Allocation %zu failed\n", i);
+            return 1;
+        }
+        std::vector<int> host(size / sizeof(int));
+        generateTestData(host.data(), host.size(), (uint32_t)i);
+        driver.memcpyHtoD(ptr, host.data(), size);
+        buffers.push_back({ptr, size, (uint32_t)i});
+    }
+
+    // 3. Consolidate the dedicated handles
+    CompactionStats stats;
+    if (pool.compact(&stats) != 0 || !verifyAll(driver, pool, buffers)) {
+        return 1;
+    }
+    CompactionPool::printCompactionStats("consolidate", stats);
+
+    // 4. Free a share of the buffers, leaving holes in the consolidated handles
+    std::vector<LiveBuffer> kept;
+    for (const LiveBuffer& buffer : buffers) {
+        if ((int)(rng() % 100) < free_percent) {
+            pool.free(buffer.ptr);
+        } else {
+            kept.push_back(buffer);
+        }
+    }
+    CompactionPoolStats before = pool.stats();
+    printf("After freeing: %zu live allocations, %zu MB live in %zu MB held (%zu handles)\n",
+           before.allocations, before.bytes_live >> 20, before.bytes_held >> 20, before.segments);
+
+    // 5. Reclaim the holes
+    if (pool.compact(&stats) != 0 || !verifyAll(driver, pool, kept)) {
+        return 1;
+    }
+    CompactionPool::printCompactionStats("reclaim", stats);
+
+    // 6. With no frees since, another pass must find nothing to move
+    if (pool.compact(&stats) != 0 || !verifyAll(driver, pool, kept)) {
+        return 1;
+    }
+    CompactionPool::printCompactionStats("settled", stats);
+    if (stats.allocations_moved != 0 || stats.pause_ns != 0) {
+        fprintf(stderr, "Compaction did not settle: second pass moved %zu allocations\n",
+                stats.allocations_moved);
+        return 1;
+    }
+
+    printf("All %zu surviving buffers verified at their original pointers\n", kept.size());
+    pool.destroy();
+    return 0;
+}
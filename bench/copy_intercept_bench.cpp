@@ -0,0 +1,149 @@
+// Per-call overhead of the wrapper's read-only checks on copies and memsets.
+// Run once plain and once with LD_PRELOAD=libcuda_ro_wrapper.so and compare
+#include "cuda_ipc_common.h"
+#include "cuda_ro_wrapper.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <vector>
+#include <dlfcn.h>
+#include <unistd.h>
+
+using Clock = std::chrono::steady_clock;
+
+struct Mapping {
+    CUmemGenericAllocationHandle handle;
+    CUdeviceptr ptr;
+    size_t size;
+};
+
+static Mapping mapHandle(CUmemGenericAllocationHandle handle, size_t size, CUdevice device,
+                         CUmemAccess_flags access) {
+    Mapping mapping = {handle, 0, size};
+    CHECK_CUDA(cuMemAddressReserve(&mapping.ptr, size, 0, 0, 0));
+    CHECK_CUDA(cuMemMap(mapping.ptr, size, 0, handle, 0));
+    CUmemAccessDesc accessDesc = {};
+    accessDesc.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+    accessDesc.location.id = device;
+    accessDesc.flags = access;
+    CHECK_CUDA(cuMemSetAccess(mapping.ptr, size, &accessDesc, 1));
+    return mapping;
+}
+
+static void unmap(const Mapping& mapping) {
+    CHECK_CUDA(cuMemUnmap(mapping.ptr, mapping.size));
+    CHECK_CUDA(cuMemAddressFree(mapping.ptr, mapping.size));
+    CHECK_CUDA(cuMemRelease(mapping.handle));
+}
+
+// Average microseconds per call of op(i) over `iterations` calls
+template <typename Op>
+static double usPerCall(int iterations, CUstream stream, Op op) {
+    op(0);  // warm-up
+    CHECK_CUDA(cuStreamSynchronize(stream));
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        op(i);
+    }
+    CHECK_CUDA(cuStreamSynchronize(stream));
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / iterations;
+}
+
+int main(int argc, char** argv) {
+    int ro_buffers = 64;
+    int iterations = 20000;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--ro-buffers") == 0 && i + 1 < argc) {
+            ro_buffers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--ro-buffers N] [--iterations N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    // 1. Wrapper present? (read-only export flag is only understood by it)
+    const bool wrapped = dlsym(RTLD_DEFAULT, CU_RO_WRAPPER_GET_REGISTRY_FD) != nullptr;
+    printf("=== Copy/Memset Interception Overhead (%s) ===\n",
+           wrapped ? "wrapper preloaded" : "no wrapper");
+
+    CUdevice device = initCudaDevice(0);
+    createCudaContext(device);
+    size_t granularity = getMemoryGranularity(device);
+    CUstream stream;
+    CHECK_CUDA(cuStreamCreate(&stream, 0));
+
+    CUmemAllocationProp prop = {};
+    prop.type = CU_MEM_ALLOCATION_TYPE_PINNED;
+    prop.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+    prop.location.id = device;
+    prop.requestedHandleTypes = CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR;
+
+    // 2. Two writable targets with read-only imports reserved between them,
+    //    so alternating targets defeats the per-thread last-hit cache
+    const size_t max_size = alignSize(64 << 20, granularity);
+    CUmemGenericAllocationHandle handle;
+    CHECK_CUDA(cuMemCreate(&handle, max_size, &prop, 0));
+    Mapping target_a = mapHandle(handle, max_size, device, CU_MEM_ACCESS_FLAGS_PROT_READWRITE);
+
+    std::vector<Mapping> read_only;
+    for (int i = 0; i < ro_buffers; ++i) {
+        CUmemGenericAllocationHandle owner, imported;
+        int fd;
+        CHECK_CUDA(cuMemCreate(&owner, granularity, &prop, 0));
+        CHECK_CUDA(cuMemExportToShareableHandle((void*)&fd, owner,
+            CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR, wrapped ? CU_MEM_EXPORT_FLAGS_READONLY : 0));
+        CHECK_CUDA(cuMemImportFromShareableHandle(&imported, (void*)(intptr_t)fd,
+            CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR));
+        close(fd);
+        CHECK_CUDA(cuMemRelease(owner));
+        read_only.push_back(mapHandle(imported, granularity, device, CU_MEM_ACCESS_FLAGS_PROT_READ));
+    }
+
+    CHECK_CUDA(cuMemCreate(&handle, max_size, &prop, 0));
+    Mapping target_b = mapHandle(handle, max_size, device, CU_MEM_ACCESS_FLAGS_PROT_READWRITE);
+    printf("Read-only imports: %d, iterations (small copies): %d\n", ro_buffers, iterations);
+
+    // 3. Per-call time by size. Large sizes are bandwidth bound; the check's
+    //    cost only shows up for small ones
+    std::vector<char> host(max_size, 0x5A);
+    const CUdeviceptr targets[2] = {target_a.ptr, target_b.ptr};
+    const size_t sizes[] = {4, 64, 4096, 64 << 10, 1 << 20, 16 << 20, 64 << 20};
+    printf("%10s %12s %12s %14s %14s\n", "bytes", "HtoD us", "HtoD alt us",
+           "DtoDAsync us", "MemsetAsync us");
+    for (size_t size : sizes) {
+        size = size < max_size ? size : max_size;
+        int n = (int)std::max<size_t>(10, (size_t)iterations * 4096 / std::max<size_t>(size, 4096));
+        double htod = usPerCall(n, stream, [&](int) {
+            CHECK_CUDA(cuMemcpyHtoD(target_a.ptr, host.data(), size));
+        });
+        double htod_alt = usPerCall(n, stream, [&](int i) {
+            CHECK_CUDA(cuMemcpyHtoD(targets[i & 1], host.data(), size));
+        });
+        double dtod = usPerCall(n, stream, [&](int) {
+            CHECK_CUDA(cuMemcpyDtoDAsync(target_a.ptr, target_b.ptr, size, stream));
+        });
+        double memset = usPerCall(n, stream, [&](int) {
+            CHECK_CUDA(cuMemsetD8Async(target_a.ptr, 0, size, stream));
+        });
+        printf("%10zu %12.3f %12.3f %14.3f %14.3f\n", size, htod, htod_alt, dtod, memset);
+    }
+
+    // 4. A write into a read-only import must be refused under the wrapper
+    if (!read_only.empty()) {
+        CUresult result = cuMemsetD8(read_only[0].ptr, 0, 1);
+        printf("Memset into read-only import: %s (result %d)\n",
+               result == CUDA_SUCCESS ? "allowed" : "rejected", result);
+    }
+
+    // 5. Cleanup
+    for (const Mapping& mapping : read_only) {
+        unmap(mapping);
+    }
+    unmap(target_a);
+    unmap(target_b);
+    CHECK_CUDA(cuStreamDestroy(stream));
+    CHECK_CUDA(cuDevicePrimaryCtxRelease(device));
+    return 0;
+}
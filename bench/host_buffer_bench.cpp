@@ -0,0 +1,115 @@
+// Consumer-side read throughput: sealed memfd host buffer vs GPU-staged copy
+#include "cuda_ipc_common.h"
+#include "host_buffer.h"
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+
+using Clock = std::chrono::steady_clock;
+
+// Touch every byte so both paths pay for actually reading the data
+static uint64_t sumBuffer(const void* data, size_t size) {
+    const uint64_t* words = static_cast<const uint64_t*>(data);
+    uint64_t sum = 0;
+    for (size_t i = 0; i < size / sizeof(uint64_t); ++i) {
+        sum += words[i];
+    }
+    return sum;
+}
+
+static double gbPerSec(size_t bytes, int iterations, double seconds) {
+    return (double)bytes * iterations / seconds / 1e9;
+}
+
+int main(int argc, char** argv) {
+    size_t size_mb = argc > 1 ? strtoul(argv[1], NULL, 10) : 256;
+    int iterations = argc > 2 ? atoi(argv[2]) : 10;
+    bool use_huge_pages = argc > 3 && strcmp(argv[3], "--huge") == 0;
+    const size_t size = size_mb * 1024 * 1024;
+
+    printf("=== Host Buffer vs GPU-Staged Read Benchmark ===\n");
+    printf("Buffer size: %zu MB, iterations: %d\n", size_mb, iterations);
+
+    // 1. Host path: producer fills and seals, consumer maps read-only
+    HostBuffer producer_buffer;
+    if (createHostBuffer(size, use_huge_pages, producer_buffer) < 0) {
+        return 1;
+    }
+    memset(producer_buffer.data, 0x5A, size);
+    if (sealHostBuffer(producer_buffer) < 0) {
+        return 1;
+    }
+
+    HostBuffer consumer_buffer;
+    if (mapHostBufferReadOnly(dup(producer_buffer.fd), size, consumer_buffer) < 0) {
+        return 1;
+    }
+
+    uint64_t host_sum = sumBuffer(consumer_buffer.data, size); // warm-up / fault in
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        host_sum += sumBuffer(consumer_buffer.data, size);
+    }
+    double host_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // 2. GPU-staged path: data lives in a VMM allocation, consumer copies it out
+    CUdevice device = initCudaDevice(0);
+    createCudaContext(device);
+    size_t granularity = getMemoryGranularity(device);
+    size_t aligned_size = alignSize(size, granularity);
+
+    CUmemAllocationProp prop = {};
+    prop.type = CU_MEM_ALLOCATION_TYPE_PINNED;
+    prop.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+    prop.location.id = device;
+    prop.requestedHandleTypes = CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR;
+
+    CUmemGenericAllocationHandle handle;
+    CUdeviceptr dptr;
+    CHECK_CUDA(cuMemCreate(&handle, aligned_size, &prop, 0));
+    CHECK_CUDA(cuMemAddressReserve(&dptr, aligned_size, 0, 0, 0));
+    CHECK_CUDA(cuMemMap(dptr, aligned_size, 0, handle, 0));
+    CUmemAccessDesc accessDesc = {};
+    accessDesc.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+    accessDesc.location.id = device;
+    accessDesc.flags = CU_MEM_ACCESS_FLAGS_PROT_READWRITE;
+    CHECK_CUDA(cuMemSetAccess(dptr, aligned_size, &accessDesc, 1));
+    copyHostToDevice(dptr, consumer_buffer.data, size);
+
+    std::vector<char> staging(size);
+    copyDeviceToHost(staging.data(), dptr, size); // warm-up
+
+    double copy_seconds = 0;
+    uint64_t gpu_sum = 0;
+    start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        auto copy_start = Clock::now();
+        copyDeviceToHost(staging.data(), dptr, size);
+        copy_seconds += std::chrono::duration<double>(Clock::now() - copy_start).count();
+        gpu_sum += sumBuffer(staging.data(), size);
+    }
+    double gpu_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // 3. Report
+    printf("Host buffer (zero-copy mmap, %s pages): %.2f GB/s\n",
+           producer_buffer.huge_pages ? "huge" : "regular",
+           gbPerSec(size, iterations, host_seconds));
+    printf("GPU-staged (cuMemcpyDtoH + read):       %.2f GB/s\n",
+           gbPerSec(size, iterations, gpu_seconds));
+    printf("GPU-staged (cuMemcpyDtoH only):         %.2f GB/s\n",
+           gbPerSec(size, iterations, copy_seconds));
+    printf("Checksums: host=%llx gpu=%llx\n",
+           (unsigned long long)host_sum, (unsigned long long)gpu_sum);
+
+    // 4. Cleanup
+    CHECK_CUDA(cuMemUnmap(dptr, aligned_size));
+    CHECK_CUDA(cuMemAddressFree(dptr, aligned_size));
+    CHECK_CUDA(cuMemRelease(handle));
+    CHECK_CUDA(cuDevicePrimaryCtxRelease(device));
+    destroyHostBuffer(consumer_buffer);
+    destroyHostBuffer(producer_buffer);
+
+    return 0;
+}
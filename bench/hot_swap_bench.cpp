@@ -0,0 +1,112 @@
+// Generation hot-swap latency and torn-read check for VersionedMapping
+#include "cuda_ipc_common.h"
+#include "versioned_mapping.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char** argv) {
+    int swaps = argc > 1 ? std::max(1, atoi(argv[1])) : 200;
+    int reader_threads = argc > 2 ? atoi(argv[2]) : 2;
+    const size_t buffer_size = 1024 * 1024;
+    const size_t element_count = buffer_size / sizeof(int);
+
+    printf("=== Generation Hot-Swap Benchmark ===\n");
+    CUdevice device = initCudaDevice(0);
+    CUcontext context = createCudaContext(device);
+    size_t granularity = getMemoryGranularity(device);
+    const size_t aligned_size = alignSize(buffer_size, granularity);
+
+    CUmemAllocationProp prop = {};
+    prop.type = CU_MEM_ALLOCATION_TYPE_PINNED;
+    prop.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+    prop.location.id = device;
+    prop.requestedHandleTypes = CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR;
+
+    CUmemAccessDesc accessDesc = {};
+    accessDesc.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+    accessDesc.location.id = device;
+    accessDesc.flags = CU_MEM_ACCESS_FLAGS_PROT_READWRITE;
+
+    // Build one generation's physical allocation (as a producer would)
+    std::vector<int> h_buffer(element_count);
+    CUdeviceptr staging;
+    CHECK_CUDA(cuMemAddressReserve(&staging, aligned_size, 0, 0, 0));
+    auto makeGeneration = [&](uint32_t generation) {
+        CUmemGenericAllocationHandle handle;
+        CHECK_CUDA(cuMemCreate(&handle, aligned_size, &prop, 0));
+        CHECK_CUDA(cuMemMap(staging, aligned_size, 0, handle, 0));
+        CHECK_CUDA(cuMemSetAccess(staging, aligned_size, &accessDesc, 1));
+        generateTestData(h_buffer.data(), element_count, generation);
+        copyHostToDevice(staging, h_buffer.data(), buffer_size);
+        CHECK_CUDA(cuMemUnmap(staging, aligned_size));
+        return handle;
+    };
+
+    VersionedMapping mapping;
+    mapping.reserve(device, aligned_size);
+    mapping.swap(makeGeneration(0), aligned_size, 0);
+    const CUdeviceptr stable_ptr = mapping.ptr();
+
+    // Readers copy the whole buffer and check it matches exactly one generation
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> reads(0), torn_reads(0), moved_ptrs(0);
+    std::vector<std::thread> readers;
+    for (int t = 0; t < reader_threads; ++t) {
+        readers.emplace_back([&]() {
+            CHECK_CUDA(cuCtxSetCurrent(context));
+            std::vector<int> snapshot(element_count);
+            while (!stop.load(std::memory_order_relaxed)) {
+                auto guard = mapping.read();
+                copyDeviceToHost(snapshot.data(), guard.ptr(), buffer_size);
+                uint32_t generation = (uint32_t)guard.generation();
+                if (guard.ptr() != stable_ptr) {
+                    moved_ptrs.fetch_add(1);
+                }
+                if (!verifyTestData(snapshot.data(), element_count, generation)) {
+                    torn_reads.fetch_add(1);
+                }
+                reads.fetch_add(1);
+            }
+        });
+    }
+
+    // Swap generations while readers run; only the remap itself is timed
+    std::vector<double> swap_us;
+    swap_us.reserve(swaps);
+    for (int generation = 1; generation <= swaps; ++generation) {
+        CUmemGenericAllocationHandle handle = makeGeneration(generation);
+        auto start = Clock::now();
+        mapping.swap(handle, aligned_size, generation);
+        swap_us.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+    }
+
+    stop.store(true);
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    std::sort(swap_us.begin(), swap_us.end());
+    double total = 0;
+    for (double us : swap_us) {
+        total += us;
+    }
+    printf("Swaps: %d, readers: %d, reads: %llu\n", swaps, reader_threads,
+           (unsigned long long)reads.load());
+    printf("Swap latency (us, incl. reader drain): min %.1f  p50 %.1f  p99 %.1f  max %.1f  avg %.1f\n",
+           swap_us.front(), swap_us[swap_us.size() / 2],
+           swap_us[std::min(swap_us.size() - 1, swap_us.size() * 99 / 100)],
+           swap_us.back(), total / swap_us.size());
+    printf("Torn reads: %llu, pointer changes: %llu\n",
+           (unsigned long long)torn_reads.load(), (unsigned long long)moved_ptrs.load());
+
+    mapping.release();
+    CHECK_CUDA(cuMemAddressFree(staging, aligned_size));
+    CHECK_CUDA(cuDevicePrimaryCtxRelease(device));
+
+    return torn_reads.load() == 0 && moved_ptrs.load() == 0 ? 0 : 1;
+}
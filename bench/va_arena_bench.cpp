@@ -0,0 +1,108 @@
+// VA reservation churn: VA arena sub-allocation vs cuMemAddressReserve/Free
+#include "cuda_ipc_common.h"
+#include "va_arena.h"
+#include <chrono>
+#include <random>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+struct ChurnOp {
+    bool allocate;
+    size_t size;      // For allocations
+    size_t victim;    // For frees: index into the live set
+};
+
+// Random alloc/free mix around a target live-set size, sizes skewed small
+static std::vector<ChurnOp> makeChurn(size_t ops, size_t target_live, size_t granularity) {
+    std::mt19937_64 rng(42);
+    std::vector<ChurnOp> churn;
+    churn.reserve(ops);
+    size_t live = 0;
+    for (size_t i = 0; i < ops; ++i) {
+        bool allocate = live == 0 || (live < target_live ? rng() % 4 != 0 : rng() % 4 == 0);
+        ChurnOp op = {allocate, 0, 0};
+        if (allocate) {
+            size_t granules = 1 + (rng() % 8 == 0 ? rng() % 64 : rng() % 4);
+            op.size = granules * granularity - rng() % granularity;
+            ++live;
+        } else {
+            op.victim = rng() % live;
+            --live;
+        }
+        churn.push_back(op);
+    }
+    return churn;
+}
+
+template <typename AllocFn, typename FreeFn>
+static double runChurn(const std::vector<ChurnOp>& churn, AllocFn alloc, FreeFn release,
+                       std::vector<std::pair<CUdeviceptr, size_t>>& live) {
+    auto start = Clock::now();
+    for (const ChurnOp& op : churn) {
+        if (op.allocate) {
+            CUdeviceptr ptr = alloc(op.size);
+            if (ptr != 0) {
+                live.push_back({ptr, op.size});
+            }
+        } else if (!live.empty()) {
+            size_t victim = op.victim % live.size();
+            release(live[victim].first, live[victim].second);
+            live[victim] = live.back();
+            live.pop_back();
+        }
+    }
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    size_t ops = argc > 1 ? strtoul(argv[1], NULL, 10) : 200000;
+    size_t target_live = argc > 2 ? strtoul(argv[2], NULL, 10) : 512;
+
+    printf("=== VA Arena Churn Benchmark ===\n");
+    CUdevice device = initCudaDevice(0);
+    createCudaContext(device);
+    size_t granularity = getMemoryGranularity(device);
+    std::vector<ChurnOp> churn = makeChurn(ops, target_live, granularity);
+    printf("Ops: %zu, target live set: %zu\n", ops, target_live);
+
+    // 1. Arena: one reservation, buddy sub-allocation
+    VAArena arena;
+    if (arena.init(VAArena::configuredSize(), granularity) < 0) {
+        return 1;
+    }
+    std::vector<std::pair<CUdeviceptr, size_t>> live;
+    double arena_seconds = runChurn(churn,
+        [&](size_t size) { return arena.allocate(size); },
+        [&](CUdeviceptr ptr, size_t) { arena.free(ptr); },
+        live);
+    arena.printStats("after churn");
+    for (auto& entry : live) {
+        arena.free(entry.first);
+    }
+    live.clear();
+    arena.printStats("drained");
+    arena.destroy();
+
+    // 2. Driver: one cuMemAddressReserve/Free per buffer
+    double driver_seconds = runChurn(churn,
+        [&](size_t size) {
+            CUdeviceptr ptr;
+            CHECK_CUDA(cuMemAddressReserve(&ptr, alignSize(size, granularity), 0, 0, 0));
+            return ptr;
+        },
+        [&](CUdeviceptr ptr, size_t size) {
+            CHECK_CUDA(cuMemAddressFree(ptr, alignSize(size, granularity)));
+        },
+        live);
+    for (auto& entry : live) {
+        CHECK_CUDA(cuMemAddressFree(entry.first, alignSize(entry.second, granularity)));
+    }
+
+    printf("Arena:  %.0f ops/sec (%.1f s)\n", ops / arena_seconds, arena_seconds);
+    printf("Driver: %.0f ops/sec (%.1f s)\n", ops / driver_seconds, driver_seconds);
+    printf("Speedup: %.1fx\n", driver_seconds / arena_seconds);
+
+    CHECK_CUDA(cuDevicePrimaryCtxRelease(device));
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include "batch_attach.h"
+#include <atomic>
+#include <thread>
+
+static void releaseVA(CUdeviceptr ptr, size_t size, const BatchAttachOptions& options,
+                      const VmmDriver& driver) {
+    if (options.arena) {
+        options.arena->free(ptr);
+    } else {
+        driver.memAddressFree(ptr, size);
+    }
+}
+
+static void attachOne(const BatchImportRequest& request, BatchImportResult& result,
+                      const BatchAttachOptions& options, const VmmDriver& driver) {
+    result = {CUDA_SUCCESS, nullptr, 0, 0, request.size};
+
+    // 1. Import handle from FD
+    result.status = driver.memImportFromShareableHandle(&result.handle,
+        (void*)(intptr_t)request.fd, CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR);
+    if (result.status != CUDA_SUCCESS) {
+        result.failed_stage = "cuMemImportFromShareableHandle";
+        return;
+    }
+
+    // 2. Reserve virtual address space
+    if (options.arena) {
+        result.ptr = options.arena->allocate(request.size);
+        if (result.ptr == 0) {
+            result.status = CUDA_ERROR_OUT_OF_MEMORY;
+        }
+    } else {
+        result.status = driver.memAddressReserve(&result.ptr, request.size, 0, 0, 0);
+    }
+    if (result.status != CUDA_SUCCESS) {
+        result.failed_stage = "reserve";
+        driver.memRelease(result.handle);
+        result.ptr = 0;
+        return;
+    }
+
+    // 3. Map imported physical memory
+    result.status = driver.memMap(result.ptr, request.size, 0, result.handle, 0);
+    if (result.status != CUDA_SUCCESS) {
+        result.failed_stage = "cuMemMap";
+        releaseVA(result.ptr, request.size, options, driver);
+        driver.memRelease(result.handle);
+        result.ptr = 0;
+        return;
+    }
+
+    // 4. Set access permissions
+    CUmemAccessDesc accessDesc = {};
+    accessDesc.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+    accessDesc.location.id = options.device;
+    accessDesc.flags = options.access;
+    result.status = driver.memSetAccess(result.ptr, request.size, &accessDesc, 1);
+    if (result.status != CUDA_SUCCESS) {
+        result.failed_stage = "cuMemSetAccess";
+        driver.memUnmap(result.ptr, request.size);
+        releaseVA(result.ptr, request.size, options, driver);
+        driver.memRelease(result.handle);
+        result.ptr = 0;
+    }
+}
+
+std::vector<BatchImportResult> batchAttach(const std::vector<BatchImportRequest>& requests,
+                                           const BatchAttachOptions& options,
+                                           const VmmDriver& driver) {
+    std::vector<BatchImportResult> results(requests.size());
+    std::atomic<size_t> next(0);
+
+    // Workers pull the next unclaimed buffer until all are done
+    auto worker = [&]() {
+        if (options.context) {
+            driver.ctxSetCurrent(options.context);
+        }
+        for (size_t i = next.fetch_add(1); i < requests.size(); i = next.fetch_add(1)) {
+            attachOne(requests[i], results[i], options, driver);
+        }
+    };
+
+    size_t num_threads = options.num_threads > 0 ? options.num_threads : 1;
+    if (num_threads > requests.size()) {
+        num_threads = requests.size();
+    }
+
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < num_threads; ++t) {
+        pool.emplace_back(worker);
+    }
+    worker();  // The calling thread works too
+    for (auto& thread : pool) {
+        thread.join();
+    }
+
+    return results;
+}
+
+void batchDetach(std::vector<BatchImportResult>& results,
+                 const BatchAttachOptions& options,
+                 const VmmDriver& driver) {
+    for (BatchImportResult& result : results) {
+        if (result.status != CUDA_SUCCESS || result.ptr == 0) {
+            continue;
+        }
+        driver.memUnmap(result.ptr, result.size);
+        releaseVA(result.ptr, result.size, options, driver);
+        driver.memRelease(result.handle);
+        result.ptr = 0;
+        result.handle = 0;
+    }
+}
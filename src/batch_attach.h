@@ -0,0 +1,43 @@
+#pragma once
+
+#include "vmm_driver.h"
+#include "va_arena.h"
+#include <cuda.h>
+#include <cstddef>
+#include <vector>
+
+// One exported buffer to attach: the received FD and its aligned size
+struct BatchImportRequest {
+    int fd;
+    size_t size;
+};
+
+// Per-buffer outcome; on failure the buffer is fully rolled back and
+// failed_stage names the call that failed
+struct BatchImportResult {
+    CUresult status;
+    const char* failed_stage;
+    CUmemGenericAllocationHandle handle;
+    CUdeviceptr ptr;
+    size_t size;
+};
+
+struct BatchAttachOptions {
+    CUdevice device;
+    CUcontext context;           // Made current on each worker
+    CUmemAccess_flags access;
+    int num_threads;
+    VAArena* arena;              // VA source; nullptr reserves per buffer
+};
+
+// Import, reserve, map and set access for every request on a worker pool.
+// Results are returned in request order. The caller keeps ownership of the
+// FDs.
+std::vector<BatchImportResult> batchAttach(const std::vector<BatchImportRequest>& requests,
+                                           const BatchAttachOptions& options,
+                                           const VmmDriver& driver = realVmmDriver());
+
+// Unmap, free and release everything batchAttach mapped successfully
+void batchDetach(std::vector<BatchImportResult>& results,
+                 const BatchAttachOptions& options,
+                 const VmmDriver& driver = realVmmDriver());
@@ -0,0 +1,343 @@
+#include "compaction_pool.h"
+#include "cuda_ipc_common.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+CompactionPool::CompactionPool()
+    : driver_(nullptr), device_(0), granularity_(0), segment_size_(0), next_segment_(1) {
+}
+
+CompactionPool::~CompactionPool() {
+    destroy();
+}
+
+int CompactionPool::init(CUdevice device, size_t granularity, const VmmDriver& driver,
+                         size_t segment_size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (granularity == 0 || segment_size < granularity) {
+        fprintf(stderr, "Compaction pool: segment size %zu below granularity %zu\n",
+                segment_size, granularity);
+        return -1;
+    }
+    driver_ = &driver;
+    device_ = device;
+    granularity_ = granularity;
+    segment_size_ = (segment_size / granularity) * granularity;
+    return 0;
+}
+
+void CompactionPool::destroy() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& entry : allocations_) {
+        driver_->memUnmap(entry.first, entry.second.size);
+        driver_->memAddressFree(entry.first, entry.second.size);
+    }
+    for (const auto& entry : segments_) {
+        driver_->memRelease(entry.second.handle);
+    }
+    allocations_.clear();
+    segments_.clear();
+}
+
+CUresult CompactionPool::mapWithAccess(CUdeviceptr ptr, size_t size, size_t offset,
+                                       CUmemGenericAllocationHandle handle) {
+    CUresult result = driver_->memMap(ptr, size, offset, handle, 0);
+    if (result != CUDA_SUCCESS) {
+        return result;
+    }
+
+    CUmemAccessDesc accessDesc = {};
+    accessDesc.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+    accessDesc.location.id = device_;
+    accessDesc.flags = CU_MEM_ACCESS_FLAGS_PROT_READWRITE;
+    result = driver_->memSetAccess(ptr, size, &accessDesc, 1);
+    if (result != CUDA_SUCCESS) {
+        driver_->memUnmap(ptr, size);
+    }
+    return result;
+}
+
+CUdeviceptr CompactionPool::allocate(size_t size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!driver_ || size == 0) {
+        return 0;
+    }
+    size_t aligned = ((size + granularity_ - 1) / granularity_) * granularity_;
+
+    CUmemAllocationProp prop = {};
+    prop.type = CU_MEM_ALLOCATION_TYPE_PINNED;
+    prop.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+    prop.location.id = device_;
+
+    CUmemGenericAllocationHandle handle;
+    CUresult result = driver_->memCreate(&handle, aligned, &prop, 0);
+    if (result != CUDA_SUCCESS) {
+        fprintf(stderr, "Compaction pool: cuMemCreate(%zu) failed: %d\n", aligned, result);
+        return 0;
+    }
+
+    CUdeviceptr ptr = 0;
+    result = driver_->memAddressReserve(&ptr, aligned, granularity_, 0, 0);
+    if (result == CUDA_SUCCESS) {
+        result = mapWithAccess(ptr, aligned, 0, handle);
+        if (result != CUDA_SUCCESS) {
+            driver_->memAddressFree(ptr, aligned);
+        }
+    }
+    if (result != CUDA_SUCCESS) {
+        fprintf(stderr, "Compaction pool: mapping %zu bytes failed: %d\n", aligned, result);
+        driver_->memRelease(handle);
+        return 0;
+    }
+
+    // Every allocation starts out on its own dedicated handle
+    uint64_t segment = next_segment_++;
+    segments_[segment] = {handle, aligned, aligned, 1, true};
+    allocations_[ptr] = {aligned, segment, 0};
+    return ptr;
+}
+
+void CompactionPool::free(CUdeviceptr ptr) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = allocations_.find(ptr);
+    if (it == allocations_.end()) {
+        fprintf(stderr, "Compaction pool: free of unknown pointer 0x%llx\n",
+                (unsigned long long)ptr);
+        return;
+    }
+
+    Allocation alloc = it->second;
+    allocations_.erase(it);
+    driver_->memUnmap(ptr, alloc.size);
+    driver_->memAddressFree(ptr, alloc.size);
+
+    // A consolidated handle keeps the hole until it is compacted again
+    Segment& segment = segments_[alloc.segment];
+    segment.live_bytes -= alloc.size;
+    if (--segment.live_count == 0) {
+        driver_->memRelease(segment.handle);
+        segments_.erase(alloc.segment);
+    }
+}
+
+size_t CompactionPool::bytesHeld() const {
+    size_t held = 0;
+    for (const auto& entry : segments_) {
+        held += entry.second.size;
+    }
+    return held;
+}
+
+void CompactionPool::releasePack(Pack& pack) {
+    if (pack.mapped) {
+        driver_->memUnmap(pack.staging, pack.size);
+    }
+    if (pack.staging) {
+        driver_->memAddressFree(pack.staging, pack.size);
+    }
+    driver_->memRelease(pack.handle);
+}
+
+int CompactionPool::compact(CompactionStats* stats) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    CompactionStats result = {};
+    result.segments_before = segments_.size();
+    result.bytes_held_before = bytesHeld();
+
+    // 1. Pick segments worth rewriting: small dedicated handles and
+    //    consolidated handles with holes. Full consolidated handles are
+    //    already packed, and segments holding an allocation too large to
+    //    move are left alone.
+    std::unordered_map<uint64_t, bool> movable;
+    for (const auto& entry : segments_) {
+        const Segment& segment = entry.second;
+        movable[entry.first] = (segment.dedicated && segment.size < segment_size_) ||
+                               segment.live_bytes < segment.size;
+    }
+    for (const auto& entry : allocations_) {
+        if (entry.second.size > segment_size_ / 2) {
+            movable[entry.second.segment] = false;
+        }
+    }
+
+    std::vector<CUdeviceptr> moving;
+    size_t candidate_segments = 0;
+    size_t candidate_bytes = 0;
+    for (const auto& entry : movable) {
+        if (!entry.second) continue;
+        candidate_segments++;
+        candidate_bytes += segments_[entry.first].size;
+    }
+    for (const auto& entry : allocations_) {
+        if (movable[entry.second.segment]) {
+            moving.push_back(entry.first);
+        }
+    }
+
+    // 2. Pack allocations in address order into handles of at most
+    //    segment_size bytes
+    std::vector<Pack> packs;
+    std::vector<size_t> pack_of(moving.size());
+    std::vector<size_t> new_offset(moving.size());
+    for (size_t i = 0; i < moving.size(); ++i) {
+        size_t size = allocations_[moving[i]].size;
+        if (packs.empty() || packs.back().size + size > segment_size_) {
+            packs.push_back({0, 0, 0, false});
+        }
+        pack_of[i] = packs.size() - 1;
+        new_offset[i] = packs.back().size;
+        packs.back().size += size;
+    }
+
+    // Skip the pass (and the owner pause) unless the new layout holds
+    // fewer handles or fewer bytes than the segments it replaces
+    size_t packed_bytes = 0;
+    for (const Pack& pack : packs) {
+        packed_bytes += pack.size;
+    }
+    if (packs.size() >= candidate_segments && packed_bytes >= candidate_bytes) {
+        result.segments_after = result.segments_before;
+        result.bytes_held_after = result.bytes_held_before;
+        if (stats) *stats = result;
+        return 0;
+    }
+
+    // 3. Create and stage the new handles while owners keep running
+    CUmemAllocationProp prop = {};
+    prop.type = CU_MEM_ALLOCATION_TYPE_PINNED;
+    prop.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+    prop.location.id = device_;
+
+    size_t prepared = 0;
+    CUresult status = CUDA_SUCCESS;
+    for (; prepared < packs.size(); ++prepared) {
+        Pack& pack = packs[prepared];
+        status = driver_->memCreate(&pack.handle, pack.size, &prop, 0);
+        if (status != CUDA_SUCCESS) break;
+        status = driver_->memAddressReserve(&pack.staging, pack.size, granularity_, 0, 0);
+        if (status == CUDA_SUCCESS) {
+            status = mapWithAccess(pack.staging, pack.size, 0, pack.handle);
+            pack.mapped = status == CUDA_SUCCESS;
+        }
+        if (status != CUDA_SUCCESS) {
+            ++prepared;  // Handle exists, release it below
+            break;
+        }
+    }
+    if (status != CUDA_SUCCESS) {
+        fprintf(stderr, "Compaction pool: staging failed (%d), compaction skipped\n", status);
+        for (size_t i = 0; i < prepared; ++i) {
+            releasePack(packs[i]);
+        }
+        return -1;
+    }
+
+    // 4. Pause owners, copy, then remap every VA onto its new sub-offset
+    size_t remapped = 0;
+    {
+        std::unique_lock<std::shared_mutex> pause(access_lock_);
+        uint64_t pause_start = monotonicNowNs();
+
+        for (size_t i = 0; i < moving.size() && status == CUDA_SUCCESS; ++i) {
+            const Pack& pack = packs[pack_of[i]];
+            size_t size = allocations_[moving[i]].size;
+            status = driver_->memcpyDtoD(pack.staging + new_offset[i], moving[i], size);
+            result.bytes_copied += size;
+        }
+        if (status == CUDA_SUCCESS) {
+            status = driver_->ctxSynchronize();
+        }
+        uint64_t copy_end = monotonicNowNs();
+
+        for (; remapped < moving.size() && status == CUDA_SUCCESS; ++remapped) {
+            CUdeviceptr ptr = moving[remapped];
+            size_t size = allocations_[ptr].size;
+            driver_->memUnmap(ptr, size);
+            status = mapWithAccess(ptr, size, new_offset[remapped], packs[pack_of[remapped]].handle);
+            if (status != CUDA_SUCCESS) {
+                // Old handles are still alive: put this one back first
+                const Allocation& alloc = allocations_[ptr];
+                mapWithAccess(ptr, size, alloc.offset, segments_[alloc.segment].handle);
+            }
+        }
+        if (status != CUDA_SUCCESS) {
+            for (size_t i = 0; i + 1 < remapped; ++i) {
+                const Allocation& alloc = allocations_[moving[i]];
+                driver_->memUnmap(moving[i], alloc.size);
+                mapWithAccess(moving[i], alloc.size, alloc.offset, segments_[alloc.segment].handle);
+            }
+        }
+
+        uint64_t pause_end = monotonicNowNs();
+        result.copy_ns = copy_end - pause_start;
+        result.remap_ns = pause_end - copy_end;
+        result.pause_ns = pause_end - pause_start;
+    }
+
+    // 5. Drop the staging VAs; on failure drop the new handles too
+    for (Pack& pack : packs) {
+        driver_->memUnmap(pack.staging, pack.size);
+        driver_->memAddressFree(pack.staging, pack.size);
+        pack.mapped = false;
+        pack.staging = 0;
+        if (status != CUDA_SUCCESS) {
+            driver_->memRelease(pack.handle);
+        }
+    }
+    if (status != CUDA_SUCCESS) {
+        fprintf(stderr, "Compaction pool: pass rolled back (%d)\n", status);
+        return -1;
+    }
+
+    // 6. Retarget bookkeeping and release the drained handles
+    std::vector<uint64_t> pack_segment(packs.size());
+    for (size_t p = 0; p < packs.size(); ++p) {
+        pack_segment[p] = next_segment_++;
+        segments_[pack_segment[p]] = {packs[p].handle, packs[p].size, packs[p].size, 0, false};
+    }
+    std::vector<uint64_t> drained;
+    for (size_t i = 0; i < moving.size(); ++i) {
+        Allocation& alloc = allocations_[moving[i]];
+        drained.push_back(alloc.segment);
+        alloc.segment = pack_segment[pack_of[i]];
+        alloc.offset = new_offset[i];
+        segments_[alloc.segment].live_count++;
+    }
+    for (uint64_t id : drained) {
+        auto it = segments_.find(id);
+        if (it != segments_.end()) {
+            driver_->memRelease(it->second.handle);
+            segments_.erase(it);
+        }
+    }
+
+    result.allocations_moved = moving.size();
+    result.segments_after = segments_.size();
+    result.bytes_held_after = bytesHeld();
+    result.bytes_reclaimed = result.bytes_held_before - result.bytes_held_after;
+    if (stats) *stats = result;
+    return 0;
+}
+
+CompactionPoolStats CompactionPool::stats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    CompactionPoolStats result = {};
+    result.segments = segments_.size();
+    result.allocations = allocations_.size();
+    for (const auto& entry : allocations_) {
+        result.bytes_live += entry.second.size;
+    }
+    result.bytes_held = bytesHeld();
+    return result;
+}
+
+void CompactionPool::printCompactionStats(const char* label, const CompactionStats& s) {
+    printf("Compaction [%s]: %zu -> %zu handles, %zu -> %zu MB held, %zu MB reclaimed\n",
+           label, s.segments_before, s.segments_after,
+           s.bytes_held_before >> 20, s.bytes_held_after >> 20, s.bytes_reclaimed >> 20);
+    printf("  moved %zu allocations (%zu MB), pause %.3f ms (copy %.3f ms, remap %.3f ms)\n",
+           s.allocations_moved, s.bytes_copied >> 20, s.pause_ns / 1e6,
+           s.copy_ns / 1e6, s.remap_ns / 1e6);
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "vmm_driver.h"
+#include <cuda.h>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+// Result of one compaction pass
+struct CompactionStats {
+    size_t segments_before;     // Physical handles held
+    size_t segments_after;
+    size_t bytes_held_before;   // Physical bytes held (live + holes)
+    size_t bytes_held_after;
+    size_t bytes_reclaimed;
+    size_t allocations_moved;
+    size_t bytes_copied;
+    uint64_t pause_ns;          // Owners blocked: copy + remap
+    uint64_t copy_ns;
+    uint64_t remap_ns;
+};
+
+struct CompactionPoolStats {
+    size_t segments;
+    size_t allocations;
+    size_t bytes_live;          // Granularity-rounded bytes of live allocations
+    size_t bytes_held;          // Physical bytes of all handles
+};
+
+// Device allocations with stable VAs over relocatable physical memory.
+// Each allocation owns its VA reservation; its physical backing starts as
+// a dedicated handle. compact() copies small allocations into consolidated
+// handles and remaps each VA onto a sub-offset of the new handle with
+// cuMemMap's offset argument, so pointers never change. Holes left by
+// allocations freed out of a consolidated handle are reclaimed the next
+// time it is compacted.
+//
+// Granularity padding can't be reclaimed: every VA must map whole
+// granules at granularity-aligned handle offsets.
+class CompactionPool {
+public:
+    CompactionPool();
+    ~CompactionPool();
+
+    // segment_size bounds consolidated handles; larger allocations are
+    // never moved
+    int init(CUdevice device, size_t granularity,
+             const VmmDriver& driver = realVmmDriver(),
+             size_t segment_size = 64 * 1024 * 1024);
+    void destroy();
+
+    // Returns 0 on failure
+    CUdeviceptr allocate(size_t size);
+    void free(CUdeviceptr ptr);
+
+    // Hold while touching pool memory (including GPU work in flight);
+    // compaction waits for all holders before copying
+    std::shared_lock<std::shared_mutex> access() {
+        return std::shared_lock<std::shared_mutex>(access_lock_);
+    }
+
+    // Returns 0 on success (including "nothing to do"), -1 if the pass was
+    // rolled back; allocations stay valid either way
+    int compact(CompactionStats* stats = nullptr);
+
+    CompactionPoolStats stats();
+    static void printCompactionStats(const char* label, const CompactionStats& stats);
+
+private:
+    CompactionPool(const CompactionPool&) = delete;
+    CompactionPool& operator=(const CompactionPool&) = delete;
+
+    struct Segment {
+        CUmemGenericAllocationHandle handle;
+        size_t size;
+        size_t live_bytes;
+        size_t live_count;
+        bool dedicated;         // One allocation's own handle (from allocate())
+    };
+
+    struct Allocation {
+        size_t size;            // Granularity-rounded
+        uint64_t segment;
+        size_t offset;          // Within the segment's handle
+    };
+
+    // A consolidated handle being filled by one compaction pass
+    struct Pack {
+        CUmemGenericAllocationHandle handle;
+        size_t size;
+        CUdeviceptr staging;    // Temporary VA used as the copy target
+        bool mapped;
+    };
+
+    CUresult mapWithAccess(CUdeviceptr ptr, size_t size, size_t offset,
+                           CUmemGenericAllocationHandle handle);
+    void releasePack(Pack& pack);
+    size_t bytesHeld() const;
+
+    std::mutex mutex_;                 // Bookkeeping; held for a whole pass
+    std::shared_mutex access_lock_;    // Owners shared, compaction exclusive
+    const VmmDriver* driver_;
+    CUdevice device_;
+    size_t granularity_;
+    size_t segment_size_;
+    uint64_t next_segment_;
+    std::unordered_map<uint64_t, Segment> segments_;
+    std::map<CUdeviceptr, Allocation> allocations_;
+};
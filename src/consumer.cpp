@@ -1,16 +1,26 @@
 #include "cuda_ipc_common.h"
 #include "ipc_socket.h"
+#include "host_buffer.h"
+#include "versioned_mapping.h"
+#include "va_arena.h"
+#include "ro_session.h"
+#include "gather_view.h"
+#include "batch_attach.h"
+#include "tensor_desc.h"
+#include "handoff_trace.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
 #include <vector>
+#include <cstring>
 #include <unistd.h>
 
-int main() {
-    printf("=== CUDA VMM Consumer ===\n");
+// Map the producer's sealed memfd host buffer directly (no CUDA needed)
+static int runHostConsumer() {
+    printf("=== Host Buffer Consumer ===\n");
 
-    // 1. Initialize CUDA
-    CUdevice device = initCudaDevice(0);
-    CUcontext context = createCudaContext(device);
-
-    // 2. Connect to producer
+    // 1. Connect to producer
     IPCSocket ipc_sock;
     printf("Connecting to producer...\n");
     if (ipc_sock.connect_to_server() < 0) {
@@ -19,70 +29,529 @@ int main() {
     }
     printf("Connected to producer\n");
 
-    // 3. Receive FD and metadata
+    // 2. Receive FD and metadata
     int received_fd;
-    size_t aligned_size;
+    size_t buffer_size;
     if (ipc_sock.recv_fd(received_fd) < 0) {
         fprintf(stderr, "Failed to receive FD\n");
         return 1;
     }
-    if (ipc_sock.recv_metadata(aligned_size) < 0) {
+    if (ipc_sock.recv_metadata(buffer_size) < 0) {
         fprintf(stderr, "Failed to receive metadata\n");
         return 1;
     }
-    printf("Received FD: %d, size: %zu bytes\n", received_fd, aligned_size);
+    printf("Received FD: %d, size: %zu bytes\n", received_fd, buffer_size);
+
+    // 3. Map read-only (zero-copy)
+    HostBuffer host_buffer;
+    if (mapHostBufferReadOnly(received_fd, buffer_size, host_buffer) < 0) {
+        ::close(received_fd);
+        return 1;
+    }
+    printf("Mapped sealed host buffer read-only\n");
+
+    // 4. Verify data in place
+    const size_t element_count = buffer_size / sizeof(int);
+    bool success = verifyTestData(static_cast<const int*>(host_buffer.data), element_count);
+    if (success) {
+        printf("Data verification PASSED (%zu integers verified)\n", element_count);
+    } else {
+        printf("Data verification FAILED\n");
+    }
+
+    // 5. Send ACK
+    if (ipc_sock.send_ack() < 0) {
+        fprintf(stderr, "Failed to send ACK\n");
+        return 1;
+    }
+    printf("Sent acknowledgment to producer\n");
+
+    // 6. Cleanup
+    destroyHostBuffer(host_buffer);
+    printf("Cleanup complete\n");
+
+    return success ? 0 : 1;
+}
+
+// Follow producer generations through one stable VA range
+static int runGenerationsConsumer(int generations) {
+    printf("=== CUDA VMM Versioned Consumer (%d generations) ===\n", generations);
+    handoffTraceInit("consumer");
+
+    // 1. Initialize CUDA and connect
+    CUdevice device = initCudaDevice(0);
+    createCudaContext(device);
+
+    IPCSocket ipc_sock;
+    printf("Connecting to producer...\n");
+    if (ipc_sock.connect_to_server() < 0) {
+        fprintf(stderr, "Failed to connect to producer\n");
+        return 1;
+    }
+    printf("Connected to producer\n");
+    if (recvReadOnlyRegistry(ipc_sock) < 0) {
+        fprintf(stderr, "Failed to attach producer's read-only registry\n");
+        return 1;
+    }
+
+    std::vector<char> h_buffer;
+
+    VersionedMapping mapping;
+    CUdeviceptr first_ptr = 0;
+    bool success = true;
+
+    for (int i = 0; i < generations; ++i) {
+        // 2. Receive the next generation
+        HandoffSpan recv_span("recv generation");
+        int received_fd;
+        BufferAnnouncement announcement;
+        uint64_t generation;
+        if (ipc_sock.recv_fd(received_fd) < 0 ||
+            ipc_sock.recv_announcement(announcement) < 0 ||
+            ipc_sock.recv_generation(generation) < 0) {
+            fprintf(stderr, "Failed to receive generation\n");
+            return 1;
+        }
+        recv_span.end();
+        const size_t aligned_size = announcement.aligned_size;
+        const size_t buffer_size = announcement.buffer_size;
+        const TensorDescriptor& tensor = announcement.tensor;
+        if (buffer_size > aligned_size) {
+            fprintf(stderr, "Generation %llu: %zu bytes exceed its %zu byte allocation\n",
+                    (unsigned long long)generation, buffer_size, aligned_size);
+            ::close(received_fd);
+            return 1;
+        }
+        if (validateTensorDescriptor(tensor, buffer_size) < 0) {
+            ::close(received_fd);
+            return 1;
+        }
+        h_buffer.resize(buffer_size);
+
+        HandoffSpan import_span("import + swap");
+        CUmemGenericAllocationHandle imported_handle;
+        CHECK_CUDA(cuMemImportFromShareableHandle(&imported_handle,
+            (void*)(intptr_t)received_fd,
+            CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR));
+        ::close(received_fd);
+
+        // 3. Remap the same VA range onto the new handle
+        // The mapping owns the handle only once swap() succeeds
+        if ((!mapping.ptr() && mapping.reserve(device, aligned_size) < 0) ||
+            mapping.swap(imported_handle, aligned_size, generation) < 0) {
+            CHECK_CUDA(cuMemRelease(imported_handle));
+            return 1;
+        }
+        if (first_ptr == 0) {
+            first_ptr = mapping.ptr();
+        }
+        import_span.end();
+
+        // 4. Verify through a read guard
+        {
+            HandoffSpan verify_span("copy + verify");
+            auto guard = mapping.read();
+            copyDeviceToHost(h_buffer.data(), guard.ptr(), buffer_size);
+            bool ok = verifyTensorData(h_buffer.data(), tensor, (uint32_t)guard.generation());
+            printf("Generation %llu at 0x%llx: %s\n",
+                   (unsigned long long)guard.generation(),
+                   (unsigned long long)guard.ptr(), ok ? "PASSED" : "FAILED");
+            success = success && ok && guard.ptr() == first_ptr;
+        }
+
+        HandoffSpan ack_span("send ack");
+        if (ipc_sock.send_ack() < 0) {
+            fprintf(stderr, "Failed to send ACK\n");
+            return 1;
+        }
+    }
+
+    // 5. Cleanup
+    mapping.release();
+    VAArena::getInstance().destroy();
+    CHECK_CUDA(cuDevicePrimaryCtxRelease(device));
+    printf("Cleanup complete\n");
+
+    return success ? 0 : 1;
+}
+
+// Gather shards from several producers into one contiguous VA range
+static int runGatherConsumer(size_t shard_count) {
+    printf("=== CUDA VMM Gather Consumer (%zu shards) ===\n", shard_count);
+
+    // 1. Initialize CUDA
+    CUdevice device = initCudaDevice(0);
+    CUcontext context = createCudaContext(device);
+
+    // 2. One thread per producer: connect, import, map at the shard's offset.
+    //    Shards land in whatever order their producers answer.
+    GatherView view;
+    std::vector<std::unique_ptr<IPCSocket>> sockets;
+    for (size_t i = 0; i < shard_count; ++i) {
+        sockets.emplace_back(new IPCSocket(shardSocketPath(i)));
+    }
+    std::vector<std::thread> workers;
+    std::atomic<bool> failed(false);
+    for (size_t i = 0; i < shard_count; ++i) {
+        workers.emplace_back([&, i]() {
+            CHECK_CUDA(cuCtxSetCurrent(context));
+            IPCSocket& sock = *sockets[i];
+            ShardAnnouncement shard;
+            int received_fd;
+            if (sock.connect_to_server(10000) < 0 || recvReadOnlyRegistry(sock) < 0 ||
+                sock.recv_shard(shard) < 0 || sock.recv_fd(received_fd) < 0) {
+                fprintf(stderr, "Failed to receive shard %zu\n", i);
+                failed = true;
+                return;
+            }
+            if (shard.shard_count != shard_count ||
+                view.reserve(device, shard.total_size, shard_count) < 0) {
+                ::close(received_fd);
+                failed = true;
+                return;
+            }
+
+            CUmemGenericAllocationHandle imported_handle;
+            CHECK_CUDA(cuMemImportFromShareableHandle(&imported_handle,
+                (void*)(intptr_t)received_fd,
+                CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR));
+            ::close(received_fd);
+            if (view.mapShard(shard.shard_index, shard.offset, shard.size, imported_handle) < 0) {
+                failed = true;
+                return;
+            }
+            printf("Mapped shard %u at offset %llu\n", shard.shard_index,
+                   (unsigned long long)shard.offset);
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    if (failed || view.waitReady(0) < 0) {
+        fprintf(stderr, "Gather view incomplete\n");
+        return 1;
+    }
+    printf("Gathered %zu bytes at 0x%llx\n", view.size(), (unsigned long long)view.ptr());
+
+    // 3. Read the whole logical buffer through the single view
+    const size_t element_count = view.size() / sizeof(int);
+    std::vector<int> h_buffer(element_count);
+    copyDeviceToHost(h_buffer.data(), view.ptr(), view.size());
+    bool success = verifyTestData(h_buffer.data(), element_count);
+    if (success) {
+        printf("Data verification PASSED (%zu integers verified)\n", element_count);
+    } else {
+        printf("Data verification FAILED\n");
+    }
+
+    // 4. Release every producer
+    for (auto& sock : sockets) {
+        if (sock->send_ack() < 0) {
+            fprintf(stderr, "Failed to send ACK\n");
+            success = false;
+        }
+    }
+
+    // 5. Cleanup
+    view.release();
+    CHECK_CUDA(cuDevicePrimaryCtxRelease(device));
+    printf("Cleanup complete\n");
+    return success ? 0 : 1;
+}
+
+// Receive many buffers over one connection and attach them in parallel
+static int runBatchConsumer(size_t buffer_count) {
+    printf("=== CUDA VMM Batch Consumer (%zu buffers) ===\n", buffer_count);
+
+    // 1. Initialize CUDA
+    CUdevice device = initCudaDevice(0);
+    CUcontext context = createCudaContext(device);
+    size_t granularity = getMemoryGranularity(device);
+
+    // 2. Receive every FD before attaching any of them
+    IPCSocket ipc_sock;
+    size_t sent_count, buffer_size;
+    if (ipc_sock.connect_to_server(10000) < 0 || recvReadOnlyRegistry(ipc_sock) < 0 ||
+        ipc_sock.recv_metadata(sent_count) < 0 || ipc_sock.recv_metadata(buffer_size) < 0) {
+        fprintf(stderr, "Failed to receive batch metadata\n");
+        return 1;
+    }
+    if (sent_count != buffer_count) {
+        fprintf(stderr, "Producer sent %zu buffers, expected %zu\n", sent_count, buffer_count);
+        return 1;
+    }
+    std::vector<BatchImportRequest> requests;
+    for (size_t i = 0; i < buffer_count; ++i) {
+        BatchImportRequest request;
+        if (ipc_sock.recv_fd(request.fd) < 0) {
+            fprintf(stderr, "Failed to receive buffer %zu\n", i);
+            return 1;
+        }
+        if (ipc_sock.recv_metadata(request.size) < 0 || buffer_size > request.size) {
+            fprintf(stderr, "Bad size for buffer %zu\n", i);
+            ::close(request.fd);
+            return 1;
+        }
+        requests.push_back(request);
+    }
+
+    // 3. Import, map and set access on a worker pool, with VA from the arena
+    VAArena& arena = VAArena::getInstance();
+    if (arena.init(VAArena::configuredSize(), granularity) < 0) {
+        return 1;
+    }
+    BatchAttachOptions options = {};
+    options.device = device;
+    options.context = context;
+    options.access = CU_MEM_ACCESS_FLAGS_PROT_READ;
+    options.num_threads = (int)std::min<size_t>(buffer_count,
+                                                std::max(1u, std::thread::hardware_concurrency()));
+    options.arena = &arena;
+    const uint64_t attach_start = monotonicNowNs();
+    std::vector<BatchImportResult> results = batchAttach(requests, options);
+    printf("Attached %zu buffers on %d threads in %.2f ms\n", buffer_count, options.num_threads,
+           (monotonicNowNs() - attach_start) / 1e6);
+    for (const BatchImportRequest& request : requests) {
+        ::close(request.fd);
+    }
+
+    // 4. Verify each buffer against its own seed
+    bool success = true;
+    const size_t element_count = buffer_size / sizeof(int);
+    std::vector<int> h_buffer(element_count);
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (results[i].status != CUDA_SUCCESS) {
+            fprintf(stderr, "Buffer %zu failed in %s (error %d)\n",
+                    i, results[i].failed_stage, (int)results[i].status);
+            success = false;
+            continue;
+        }
+        copyDeviceToHost(h_buffer.data(), results[i].ptr, buffer_size);
+        if (!verifyTestData(h_buffer.data(), element_count, (uint32_t)i)) {
+            fprintf(stderr, "Buffer %zu failed verification\n", i);
+            success = false;
+        }
+    }
+    if (success) {
+        printf("Data verification PASSED (%zu buffers)\n", buffer_count);
+    } else {
+        printf("Data verification FAILED\n");
+    }
+    if (ipc_sock.send_ack() < 0) {
+        fprintf(stderr, "Failed to send ACK\n");
+        success = false;
+    }
+
+    // 5. Cleanup
+    batchDetach(results, options);
+    arena.destroy();
+    CHECK_CUDA(cuDevicePrimaryCtxRelease(device));
+    printf("Cleanup complete\n");
+    return success ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    bool serial = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--serial") == 0) {
+            serial = true;
+        } else if (strcmp(argv[i], "--host") == 0) {
+            return runHostConsumer();
+        } else if (strcmp(argv[i], "--generations") == 0 && i + 1 < argc) {
+            return runGenerationsConsumer(atoi(argv[i + 1]));
+        } else if (strcmp(argv[i], "--shards") == 0 && i + 1 < argc) {
+            return runGatherConsumer(strtoul(argv[i + 1], NULL, 10));
+        } else if (strcmp(argv[i], "--buffers") == 0 && i + 1 < argc) {
+            size_t count = strtoul(argv[i + 1], NULL, 10);
+            if (count == 0) {
+                fprintf(stderr, "--buffers expects a positive count\n");
+                return 1;
+            }
+            return runBatchConsumer(count);
+        } else {
+            fprintf(stderr, "Usage: %s [--serial | --host | --generations N | --shards N | --buffers N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    const uint64_t start_ns = monotonicNowNs();
+    handoffTraceInit("consumer");
+    printf("=== CUDA VMM Consumer%s ===\n", serial ? " (serial startup)" : "");
+
+    // 1. Initialize CUDA, in the background unless starting serially
+    CUdevice device;
+    CUcontext context;
+    size_t granularity;
+    auto initCuda = [&]() {
+        HandoffSpan span("cuda init");
+        device = initCudaDevice(0);
+        context = createCudaContext(device);
+        granularity = getMemoryGranularity(device);
+    };
+    std::thread init_thread;
+    if (serial) {
+        initCuda();
+    } else {
+        init_thread = std::thread(initCuda);
+    }
+    auto fail = [&]() {
+        if (init_thread.joinable()) {
+            init_thread.join();
+        }
+        return 1;
+    };
+
+    // 2. Connect to producer (it may still be starting up)
+    IPCSocket ipc_sock;
+    printf("Connecting to producer...\n");
+    HandoffSpan connect_span("connect");
+    if (ipc_sock.connect_to_server(10000) < 0) {
+        fprintf(stderr, "Failed to connect to producer\n");
+        return fail();
+    }
+    connect_span.end();
+    printf("Connected to producer\n");
+    HandoffSpan announce_span("recv registry + announcement");
+    if (recvReadOnlyRegistry(ipc_sock) < 0) {
+        fprintf(stderr, "Failed to attach producer's read-only registry\n");
+        return fail();
+    }
 
-    // 4. Import handle from FD
+    // 3. Receive the buffer announcement
+    BufferAnnouncement announcement;
+    if (ipc_sock.recv_announcement(announcement) < 0) {
+        fprintf(stderr, "Failed to receive announcement\n");
+        return fail();
+    }
+    announce_span.end();
+    const size_t aligned_size = announcement.aligned_size;
+    const size_t buffer_size = announcement.buffer_size;
+    const TensorDescriptor& tensor = announcement.tensor;
+    printf("Announced buffer: %zu bytes, aligned size: %zu bytes\n", buffer_size, aligned_size);
+    if (validateTensorDescriptor(tensor, buffer_size) < 0) {
+        return fail();
+    }
+    printf("Announced tensor: %s, %u dims, %zu elements\n",
+           tensorDTypeName((TensorDType)tensor.dtype), tensor.ndim, tensorElementCount(tensor));
+
+    // 4. Reserve virtual address space and prepare access while the
+    //    producer is still exporting and filling the buffer
+    HandoffSpan join_span("wait cuda init");
+    if (init_thread.joinable()) {
+        init_thread.join();
+        CHECK_CUDA(cuCtxSetCurrent(context));
+    }
+    join_span.end();
+    HandoffSpan reserve_span("reserve");
+    VAArena& arena = VAArena::getInstance();
+    if (arena.init(VAArena::configuredSize(), granularity) < 0) {
+        return 1;
+    }
+    CUdeviceptr consumer_dptr = arena.allocate(aligned_size);
+    if (consumer_dptr == 0) {
+        fprintf(stderr, "VA arena exhausted\n");
+        return 1;
+    }
+    reserve_span.end();
+    printf("Reserved virtual address space at 0x%llx\n", (unsigned long long)consumer_dptr);
+
+    CUmemAccessDesc accessDesc = {};
+    accessDesc.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+    accessDesc.location.id = device;
+    accessDesc.flags = CU_MEM_ACCESS_FLAGS_PROT_READWRITE;
+    // accessDesc.flags = CU_MEM_ACCESS_FLAGS_PROT_READ;
+
+    // 5. Receive FD
+    HandoffSpan fd_span("recvmsg fd");
+    int received_fd;
+    if (ipc_sock.recv_fd(received_fd) < 0) {
+        fprintf(stderr, "Failed to receive FD\n");
+        return 1;
+    }
+    fd_span.end();
+    printf("Received FD: %d\n", received_fd);
+
+    // 6. Import handle from FD
+    HandoffSpan import_span("import");
     CUmemGenericAllocationHandle imported_handle;
     CHECK_CUDA(cuMemImportFromShareableHandle(&imported_handle,
         (void*)(intptr_t)received_fd,
         CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR));
+    import_span.end();
     printf("Imported allocation handle from FD\n");
 
-    // 5. Reserve virtual address space
-    CUdeviceptr consumer_dptr;
-    CHECK_CUDA(cuMemAddressReserve(&consumer_dptr, aligned_size, 0, 0, 0));
-    printf("Reserved virtual address space at 0x%llx\n", (unsigned long long)consumer_dptr);
-
-    // 6. Map imported physical memory
+    // 7. Map imported physical memory
+    HandoffSpan map_span("map + set access");
     CHECK_CUDA(cuMemMap(consumer_dptr, aligned_size, 0, imported_handle, 0));
     printf("Mapped imported memory to virtual address\n");
 
-    // 7. Set access permissions
-    CUmemAccessDesc accessDesc = {};
-    accessDesc.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
-    accessDesc.location.id = device;
-    accessDesc.flags = CU_MEM_ACCESS_FLAGS_PROT_READWRITE;
-    // accessDesc.flags = CU_MEM_ACCESS_FLAGS_PROT_READ;
+    // 8. Set access permissions
     CHECK_CUDA(cuMemSetAccess(consumer_dptr, aligned_size, &accessDesc, 1));
+    map_span.end();
     printf("Set read/write access permissions\n");
 
-    // 8. Copy data from GPU to host
-    const size_t buffer_size = 1024 * 1024; // Same as producer
-    const size_t element_count = buffer_size / sizeof(int);
-    std::vector<int> h_buffer(element_count);
+    // 9. Expose the mapping as a DLPack tensor (zero-copy hand-off to a framework;
+    //    the mapping outlives it, so no release callback)
+    DLDevice dl_device = {kDLCUDA, (int32_t)device};
+    DLManagedTensor* dl_tensor = toDLPack((void*)consumer_dptr, dl_device, tensor);
+    if (!dl_tensor) {
+        return 1;
+    }
+    printf("DLPack tensor at 0x%llx: code %u, %u bits, ndim %d\n",
+           (unsigned long long)(uintptr_t)dl_tensor->dl_tensor.data, dl_tensor->dl_tensor.dtype.code,
+           dl_tensor->dl_tensor.dtype.bits, dl_tensor->dl_tensor.ndim);
+
+    // 10. Block only on the producer's data-ready signal
+    HandoffSpan ready_span("wait ready");
+    if (ipc_sock.wait_ready() < 0) {
+        fprintf(stderr, "Failed to receive data-ready signal\n");
+        return 1;
+    }
+    ready_span.end();
+
+    // 11. Copy data from GPU to host (first page timed as time-to-first-byte)
+    std::vector<char> h_buffer(buffer_size);
+    const size_t first_chunk = buffer_size < 4096 ? buffer_size : 4096;
+
+    HandoffSpan copy_span("copy to host");
+    copyDeviceToHost(h_buffer.data(), consumer_dptr, first_chunk);
+    uint64_t first_byte_ns = monotonicNowNs();
+    printf("Time to first byte: %.2f ms since consumer start, %.2f ms since producer start\n",
+           (first_byte_ns - start_ns) / 1e6,
+           (first_byte_ns - announcement.producer_start_ns) / 1e6);
 
-    copyDeviceToHost(h_buffer.data(), consumer_dptr, buffer_size);
+    copyDeviceToHost(h_buffer.data() + first_chunk, consumer_dptr + first_chunk,
+                     buffer_size - first_chunk);
+    copy_span.end();
     printf("Copied %zu bytes from GPU to host\n", buffer_size);
 
-    // 9. Verify data
-    bool success = verifyTestData(h_buffer.data(), element_count);
+    // 12. Verify data as the announced element type
+    HandoffSpan verify_span("verify");
+    bool success = verifyTensorData(h_buffer.data(), tensor);
+    verify_span.end();
     if (success) {
-        printf("Data verification PASSED (%zu integers verified)\n", element_count);
+        printf("Data verification PASSED (%zu %s elements verified)\n",
+               tensorElementCount(tensor), tensorDTypeName((TensorDType)tensor.dtype));
     } else {
         printf("Data verification FAILED\n");
     }
 
-    // 10. Send ACK
+    // 13. Send ACK
+    HandoffSpan ack_span("send ack");
     if (ipc_sock.send_ack() < 0) {
         fprintf(stderr, "Failed to send ACK\n");
         return 1;
     }
+    ack_span.end();
     printf("Sent acknowledgment to producer\n");
 
-    // 11. Cleanup
+    // 14. Cleanup
+    HandoffSpan cleanup_span("cleanup");
+    dl_tensor->deleter(dl_tensor);
     CHECK_CUDA(cuMemUnmap(consumer_dptr, aligned_size));
-    CHECK_CUDA(cuMemAddressFree(consumer_dptr, aligned_size));
+    arena.free(consumer_dptr);
+    arena.destroy();
     CHECK_CUDA(cuMemRelease(imported_handle));
     ::close(received_fd);
     CHECK_CUDA(cuDevicePrimaryCtxRelease(device));
@@ -1,15 +1,4 @@
 #include "cuda_ipc_common.h"
-#include <cstring>
-
-void checkCudaError(CUresult result, const char* call, const char* file, int line) {
-    if (result != CUDA_SUCCESS) {
-        const char* error_str;
-        cuGetErrorString(result, &error_str);
-        fprintf(stderr, "CUDA error at %s:%d\n", file, line);
-        fprintf(stderr, "  %s failed with: %s\n", call, error_str);
-        exit(1);
-    }
-}
 
 CUdevice initCudaDevice(int device_id) {
     CHECK_CUDA(cuInit(0));
@@ -62,10 +51,6 @@ size_t getMemoryGranularity(CUdevice device) {
     return granularity;
 }
 
-size_t alignSize(size_t size, size_t granularity) {
-    return ((size + granularity - 1) / granularity) * granularity;
-}
-
 void copyHostToDevice(CUdeviceptr dst, const void* src, size_t size) {
     CHECK_CUDA(cuMemcpyHtoD(dst, src, size));
 }
@@ -73,21 +58,3 @@ void copyHostToDevice(CUdeviceptr dst, const void* src, size_t size) {
 void copyDeviceToHost(void* dst, CUdeviceptr src, size_t size) {
     CHECK_CUDA(cuMemcpyDtoH(dst, src, size));
 }
-
-void generateTestData(int* buffer, size_t count) {
-    for (size_t i = 0; i < count; ++i) {
-        buffer[i] = (i * 2 + 1337) ^ 0xDEADBEEF;
-    }
-}
-
-bool verifyTestData(const int* buffer, size_t count) {
-    for (size_t i = 0; i < count; ++i) {
-        int expected = (i * 2 + 1337) ^ 0xDEADBEEF;
-        if (buffer[i] != expected) {
-            fprintf(stderr, "Data mismatch at index %zu: expected %d, got %d\n",
-                    i, expected, buffer[i]);
-            return false;
-        }
-    }
-    return true;
-}
@@ -2,8 +2,10 @@
 
 #include <cuda.h>
 #include <cstddef>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 
 // CUDA error checking macro
 #define CHECK_CUDA(call) checkCudaError((call), #call, __FILE__, __LINE__)
@@ -26,6 +28,81 @@ size_t alignSize(size_t size, size_t granularity);
 void copyHostToDevice(CUdeviceptr dst, const void* src, size_t size);
 void copyDeviceToHost(void* dst, CUdeviceptr src, size_t size);
 
-// Test data generation and verification
-void generateTestData(int* buffer, size_t count);
-bool verifyTestData(const int* buffer, size_t count);
+// CLOCK_MONOTONIC in nanoseconds (comparable across processes on one host)
+uint64_t monotonicNowNs();
+
+// 16-bit IEEE half, stored as raw bits (host code never does arithmetic on it)
+struct Float16 {
+    uint16_t bits;
+    bool operator==(Float16 other) const { return bits == other.bits; }
+    bool operator!=(Float16 other) const { return bits != other.bits; }
+};
+
+// Maps the 32-bit test pattern onto an element type. Every value is exactly
+// representable, so verification compares bits and never rounds
+template <typename T> struct TestDataTraits;
+template <> struct TestDataTraits<int> {
+    static int make(uint32_t pattern) { return (int)pattern; }
+    static uint64_t bits(int value) { return (uint32_t)value; }
+};
+template <> struct TestDataTraits<int8_t> {
+    static int8_t make(uint32_t pattern) { return (int8_t)pattern; }
+    static uint64_t bits(int8_t value) { return (uint8_t)value; }
+};
+template <> struct TestDataTraits<uint8_t> {
+    static uint8_t make(uint32_t pattern) { return (uint8_t)pattern; }
+    static uint64_t bits(uint8_t value) { return value; }
+};
+template <> struct TestDataTraits<float> {
+    // 24-bit signed integer: exact in a float mantissa
+    static float make(uint32_t pattern) { return (float)((int32_t)pattern >> 8); }
+    static uint64_t bits(float value) { uint32_t b; memcpy(&b, &value, sizeof(b)); return b; }
+};
+template <> struct TestDataTraits<Float16> {
+    // Clearing the exponent's top bit keeps every value finite (no Inf/NaN)
+    static Float16 make(uint32_t pattern) { return Float16{(uint16_t)(pattern & 0xBFFF)}; }
+    static uint64_t bits(Float16 value) { return value.bits; }
+};
+
+// Only the low 32 bits of the index matter; 32-bit math keeps loops vectorizable
+inline uint32_t testDataPattern(size_t index, uint32_t seed) {
+    return ((uint32_t)index * 2u + 1337u) ^ 0xDEADBEEFu ^ (seed * 0x9E3779B9u);
+}
+
+void reportTestDataMismatch(size_t index, uint64_t expected_bits, uint64_t actual_bits);
+
+// Test data generation and verification (seed distinguishes generations;
+// first_index places a shard within a larger logical buffer)
+template <typename T>
+void generateTestData(T* buffer, size_t count, uint32_t seed = 0, size_t first_index = 0) {
+    for (size_t i = 0; i < count; ++i) {
+        buffer[i] = TestDataTraits<T>::make(testDataPattern(first_index + i, seed));
+    }
+}
+
+// Compares a block at a time without an early exit so the loop vectorizes;
+// only a failing block is rescanned to report the first mismatch
+template <typename T>
+bool verifyTestData(const T* buffer, size_t count, uint32_t seed = 0, size_t first_index = 0) {
+    constexpr size_t BLOCK = 4096;
+    for (size_t start = 0; start < count; start += BLOCK) {
+        const size_t end = count - start < BLOCK ? count : start + BLOCK;
+        uint64_t diff = 0;
+        for (size_t i = start; i < end; ++i) {
+            diff |= TestDataTraits<T>::bits(buffer[i]) ^
+                    TestDataTraits<T>::bits(TestDataTraits<T>::make(testDataPattern(first_index + i, seed)));
+        }
+        if (diff == 0) {
+            continue;
+        }
+        for (size_t i = start; i < end; ++i) {
+            T expected = TestDataTraits<T>::make(testDataPattern(first_index + i, seed));
+            if (buffer[i] != expected) {
+                reportTestDataMismatch(first_index + i, TestDataTraits<T>::bits(expected),
+                                       TestDataTraits<T>::bits(buffer[i]));
+                return false;
+            }
+        }
+    }
+    return true;
+}
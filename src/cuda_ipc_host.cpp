@@ -0,0 +1,39 @@
+// Helpers from cuda_ipc_common.h that never call libcuda, so tools built
+// against the emulated driver can link without it
+#include "cuda_ipc_common.h"
+#include <dlfcn.h>
+#include <ctime>
+
+void checkCudaError(CUresult result, const char* call, const char* file, int line) {
+    if (result != CUDA_SUCCESS) {
+        // Looked up at runtime: the emulation-only builds don't link libcuda
+        using GetErrorStringFn = CUresult (*)(CUresult, const char**);
+        auto get_error_string = (GetErrorStringFn)dlsym(RTLD_DEFAULT, "cuGetErrorString");
+        const char* error_str = nullptr;
+        if (!get_error_string || get_error_string(result, &error_str) != CUDA_SUCCESS) {
+            error_str = nullptr;
+        }
+        fprintf(stderr, "CUDA error at %s:%d\n", file, line);
+        if (error_str) {
+            fprintf(stderr, "  %s failed with: %s\n", call, error_str);
+        } else {
+            fprintf(stderr, "  %s failed with: error %d\n", call, (int)result);
+        }
+        exit(1);
+    }
+}
+
+size_t alignSize(size_t size, size_t granularity) {
+    return ((size + granularity - 1) / granularity) * granularity;
+}
+
+uint64_t monotonicNowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void reportTestDataMismatch(size_t index, uint64_t expected_bits, uint64_t actual_bits) {
+    fprintf(stderr, "Data mismatch at index %zu: expected 0x%llx, got 0x%llx\n", index,
+            (unsigned long long)expected_bits, (unsigned long long)actual_bits);
+}
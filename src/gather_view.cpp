@@ -0,0 +1,128 @@
+#include "gather_view.h"
+#include <chrono>
+#include <cstdio>
+
+GatherView::GatherView()
+    : driver_(nullptr), device_(0), access_(CU_MEM_ACCESS_FLAGS_PROT_READ),
+      base_(0), total_size_(0), mapped_count_(0), in_flight_(0) {
+}
+
+GatherView::~GatherView() {
+    release();
+}
+
+int GatherView::reserve(CUdevice device, size_t total_size, size_t shard_count,
+                        CUmemAccess_flags access, const VmmDriver& driver) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (base_ != 0) {
+        if (total_size != total_size_ || shard_count != shards_.size()) {
+            fprintf(stderr, "Gather view: shard disagrees on geometry (%zu bytes / %zu shards, "
+                    "reserved %zu / %zu)\n", total_size, shard_count, total_size_, shards_.size());
+            return -1;
+        }
+        return 0;
+    }
+    if (total_size == 0 || shard_count == 0) {
+        return -1;
+    }
+
+    CUresult result = driver.memAddressReserve(&base_, total_size, 0, 0, 0);
+    if (result != CUDA_SUCCESS) {
+        fprintf(stderr, "Gather view: failed to reserve %zu bytes: %d\n", total_size, result);
+        base_ = 0;
+        return -1;
+    }
+    driver_ = &driver;
+    device_ = device;
+    access_ = access;
+    total_size_ = total_size;
+    mapped_count_ = 0;
+    shards_.assign(shard_count, Shard{false, 0, 0, 0});
+    return 0;
+}
+
+int GatherView::mapShard(size_t index, size_t offset, size_t size,
+                         CUmemGenericAllocationHandle handle) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    bool valid = base_ != 0 && index < shards_.size() && !shards_[index].mapped &&
+                 size > 0 && offset <= total_size_ && size <= total_size_ - offset;
+    for (size_t i = 0; valid && i < shards_.size(); ++i) {
+        const Shard& other = shards_[i];
+        valid = !other.mapped || offset + size <= other.offset || other.offset + other.size <= offset;
+    }
+    if (!valid) {
+        fprintf(stderr, "Gather view: rejected shard %zu at [%zu, +%zu)\n", index, offset, size);
+        // Before reserve() there is no driver yet; the handle came from libcuda
+        (driver_ ? *driver_ : realVmmDriver()).memRelease(handle);
+        return -1;
+    }
+
+    // Claim the slot so a concurrent duplicate is rejected, then map
+    // without holding the lock: driver calls for different shards overlap.
+    // release() waits until in_flight_ drops back to zero.
+    shards_[index] = Shard{true, offset, size, handle};
+    ++in_flight_;
+    lock.unlock();
+
+    CUdeviceptr ptr = base_ + offset;
+    CUresult result = driver_->memMap(ptr, size, 0, handle, 0);
+    if (result == CUDA_SUCCESS) {
+        CUmemAccessDesc accessDesc = {};
+        accessDesc.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+        accessDesc.location.id = device_;
+        accessDesc.flags = access_;
+        result = driver_->memSetAccess(ptr, size, &accessDesc, 1);
+        if (result != CUDA_SUCCESS) {
+            driver_->memUnmap(ptr, size);
+        }
+    }
+
+    lock.lock();
+    if (--in_flight_ == 0) {
+        idle_cv_.notify_all();
+    }
+    if (result != CUDA_SUCCESS) {
+        fprintf(stderr, "Gather view: mapping shard %zu failed: %d\n", index, result);
+        shards_[index].mapped = false;
+        driver_->memRelease(handle);
+        return -1;
+    }
+    if (++mapped_count_ == shards_.size()) {
+        ready_cv_.notify_all();
+    }
+    return 0;
+}
+
+bool GatherView::ready() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !shards_.empty() && mapped_count_ == shards_.size();
+}
+
+int GatherView::waitReady(int timeout_ms) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto all_mapped = [this]() { return !shards_.empty() && mapped_count_ == shards_.size(); };
+    if (timeout_ms < 0) {
+        ready_cv_.wait(lock, all_mapped);
+        return 0;
+    }
+    return ready_cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms), all_mapped) ? 0 : -1;
+}
+
+void GatherView::release() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_cv_.wait(lock, [this]() { return in_flight_ == 0; });
+    if (base_ == 0) {
+        return;
+    }
+    for (const Shard& shard : shards_) {
+        if (shard.mapped) {
+            driver_->memUnmap(base_ + shard.offset, shard.size);
+            driver_->memRelease(shard.handle);
+        }
+    }
+    driver_->memAddressFree(base_, total_size_);
+    base_ = 0;
+    total_size_ = 0;
+    mapped_count_ = 0;
+    shards_.clear();
+}
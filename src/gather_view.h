@@ -0,0 +1,67 @@
+#pragma once
+
+#include "vmm_driver.h"
+#include <cuda.h>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// One contiguous consumer VA range assembled from shards that different
+// producers export. Each imported shard handle is mapped at its assigned
+// offset inside the range, so the whole logical buffer is readable through
+// ptr() without copying.
+//
+// Shards may arrive in any order and from any thread; the view is ready
+// once every shard is mapped.
+class GatherView {
+public:
+    GatherView();
+    ~GatherView();
+
+    // Reserve the range. Safe to call from every shard's thread: the first
+    // call reserves, later calls must agree on the geometry (-1 otherwise).
+    int reserve(CUdevice device, size_t total_size, size_t shard_count,
+                CUmemAccess_flags access = CU_MEM_ACCESS_FLAGS_PROT_READ,
+                const VmmDriver& driver = realVmmDriver());
+
+    // Map shard `index` at `offset`. Takes ownership of handle (released
+    // on failure too, through the real driver if reserve() hasn't run).
+    // Rejects out-of-range, overlapping or repeated shards.
+    int mapShard(size_t index, size_t offset, size_t size, CUmemGenericAllocationHandle handle);
+
+    bool ready();
+    // Returns 0 once all shards are mapped, -1 on timeout (timeout_ms < 0 waits forever)
+    int waitReady(int timeout_ms = -1);
+
+    // Waits for shards still being mapped, then unmaps every shard,
+    // releases their handles and frees the range
+    void release();
+
+    CUdeviceptr ptr() const { return base_; }
+    size_t size() const { return total_size_; }
+
+private:
+    GatherView(const GatherView&) = delete;
+    GatherView& operator=(const GatherView&) = delete;
+
+    struct Shard {
+        bool mapped;
+        size_t offset;
+        size_t size;
+        CUmemGenericAllocationHandle handle;
+    };
+
+    std::mutex mutex_;
+    std::condition_variable ready_cv_;
+    std::condition_variable idle_cv_;     // Signalled when in_flight_ drops to 0
+    const VmmDriver* driver_;
+    CUdevice device_;
+    CUmemAccess_flags access_;
+    CUdeviceptr base_;
+    size_t total_size_;
+    size_t mapped_count_;
+    size_t in_flight_;                    // Shards claimed but still mapping
+    std::vector<Shard> shards_;
+};
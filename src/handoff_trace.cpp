@@ -0,0 +1,132 @@
+#include "handoff_trace.h"
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+bool g_handoff_trace_enabled = false;
+
+namespace {
+
+constexpr uint32_t TRACE_CAPACITY = 4096;
+
+enum class EventKind : uint8_t { Span, FlowStart, FlowEnd };
+
+struct TraceEvent {
+    const char* name;
+    uint64_t start_ns;
+    uint64_t end_ns;     // Flows: the id (sender's timestamp)
+    uint32_t tid;
+    EventKind kind;
+};
+
+TraceEvent g_events[TRACE_CAPACITY];
+std::atomic<uint32_t> g_event_count(0);
+std::atomic<uint64_t> g_dropped(0);
+std::string g_path;
+std::string g_role;
+
+thread_local uint32_t t_tid = 0;
+
+void record(EventKind kind, const char* name, uint64_t start_ns, uint64_t end_ns) {
+    if (t_tid == 0) {
+        t_tid = (uint32_t)syscall(SYS_gettid);
+    }
+    uint32_t slot = g_event_count.fetch_add(1, std::memory_order_relaxed);
+    if (slot >= TRACE_CAPACITY) {
+        g_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    g_events[slot] = {name, start_ns, end_ns, t_tid, kind};
+}
+
+void writeAtExit() {
+    handoffTraceWrite();
+}
+
+}  // namespace
+
+uint64_t handoffTraceNow() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void handoffTraceInit(const char* role) {
+    const char* prefix = getenv("CUDA_VMM_HANDOFF_TRACE");
+    if (!prefix || !*prefix || g_handoff_trace_enabled) {
+        return;
+    }
+    g_path = std::string(prefix) + "." + role + ".json";
+    g_role = role;
+    g_handoff_trace_enabled = true;
+    atexit(writeAtExit);
+}
+
+void handoffTraceSpan(const char* name, uint64_t start_ns, uint64_t end_ns) {
+    if (handoffTraceEnabled()) {
+        record(EventKind::Span, name, start_ns, end_ns);
+    }
+}
+
+void handoffTraceSend(const char* name, uint64_t sent_ns) {
+    if (handoffTraceEnabled()) {
+        record(EventKind::FlowStart, name, sent_ns, sent_ns);
+    }
+}
+
+void handoffTraceReceive(const char* name, uint64_t sent_ns) {
+    if (handoffTraceEnabled()) {
+        record(EventKind::FlowEnd, name, handoffTraceNow(), sent_ns);
+    }
+}
+
+int handoffTraceWrite() {
+    if (!g_handoff_trace_enabled) {
+        return 0;
+    }
+    g_handoff_trace_enabled = false;
+
+    FILE* file = fopen(g_path.c_str(), "w");
+    if (!file) {
+        fprintf(stderr, "Failed to write handoff trace %s: %s\n", g_path.c_str(), strerror(errno));
+        return -1;
+    }
+
+    // One event per line, so traces from several processes merge by
+    // concatenating lines (see tools/handoff_trace_merge.cpp)
+    const int pid = getpid();
+    const uint32_t count = std::min<uint32_t>(g_event_count.load(), TRACE_CAPACITY);
+    fprintf(file, "{\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+            "\"args\":{\"name\":\"%s\"}}", pid, pid, g_role.c_str());
+    for (uint32_t i = 0; i < count; ++i) {
+        const TraceEvent& event = g_events[i];
+        switch (event.kind) {
+        case EventKind::Span:
+            fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"handoff\",\"ph\":\"X\",\"ts\":%.3f,"
+                    "\"dur\":%.3f,\"pid\":%d,\"tid\":%u}", event.name, event.start_ns / 1e3,
+                    (event.end_ns - event.start_ns) / 1e3, pid, event.tid);
+            break;
+        case EventKind::FlowStart:
+        case EventKind::FlowEnd:
+            fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"handoff\",\"ph\":\"%s\",\"id\":\"0x%llx\","
+                    "\"ts\":%.3f,\"pid\":%d,\"tid\":%u%s}", event.name,
+                    event.kind == EventKind::FlowStart ? "s" : "f",
+                    (unsigned long long)event.end_ns, event.start_ns / 1e3, pid, event.tid,
+                    event.kind == EventKind::FlowEnd ? ",\"bp\":\"e\"" : "");
+            break;
+        }
+    }
+    fprintf(file, "\n],\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped_events\":%llu}}\n",
+            (unsigned long long)g_dropped.load());
+    fclose(file);
+    printf("Wrote handoff trace %s (%u events)\n", g_path.c_str(), count);
+    return 0;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Per-phase timeline of a producer/consumer handoff, written as Chrome trace
+// JSON (loads in chrome://tracing and Perfetto). Enabled by
+// CUDA_VMM_HANDOFF_TRACE=<prefix>; each process writes <prefix>.<role>.json
+// at exit. Timestamps are CLOCK_MONOTONIC, which all processes on a host
+// share, so traces merge into one timeline (tools/handoff_trace_merge).
+//
+// Disabled, every recording call is a single branch on a global flag.
+// Enabled, events go to a fixed preallocated buffer (no locks, no
+// allocation); events past its capacity are counted and dropped.
+
+extern bool g_handoff_trace_enabled;
+
+inline bool handoffTraceEnabled() {
+    return __builtin_expect(g_handoff_trace_enabled, 0);
+}
+
+// CLOCK_MONOTONIC in nanoseconds (monotonicNowNs without the CUDA header)
+uint64_t handoffTraceNow();
+
+// Reads CUDA_VMM_HANDOFF_TRACE and registers the exit-time writer. The
+// role names the process in the timeline and in the file name
+void handoffTraceInit(const char* role);
+
+// Event names must be string literals (only the pointer is stored)
+void handoffTraceSpan(const char* name, uint64_t start_ns, uint64_t end_ns);
+
+// A message crossing processes: the sender starts a flow at its send time,
+// the receiver ends it on receipt. Both sides pass the send timestamp
+// carried in the message, which doubles as the flow id
+void handoffTraceSend(const char* name, uint64_t sent_ns);
+void handoffTraceReceive(const char* name, uint64_t sent_ns);
+
+// Write the trace now instead of at exit; later events are not recorded
+int handoffTraceWrite();
+
+// Records [construction, end()) as one phase; end() runs on destruction if
+// not called, so early error returns still show up
+class HandoffSpan {
+public:
+    explicit HandoffSpan(const char* name)
+        : name_(name), start_ns_(handoffTraceEnabled() ? handoffTraceNow() : 0) {}
+    ~HandoffSpan() { end(); }
+
+    void end() {
+        if (start_ns_) {
+            handoffTraceSpan(name_, start_ns_, handoffTraceNow());
+            start_ns_ = 0;
+        }
+    }
+
+    HandoffSpan(const HandoffSpan&) = delete;
+    HandoffSpan& operator=(const HandoffSpan&) = delete;
+
+private:
+    const char* name_;
+    uint64_t start_ns_;  // 0 when tracing is off or already recorded
+};
@@ -0,0 +1,130 @@
+#include "host_buffer.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+
+constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+constexpr int REQUIRED_SEALS = F_SEAL_WRITE | F_SEAL_GROW | F_SEAL_SHRINK;
+
+static void resetHostBuffer(HostBuffer& buffer) {
+    buffer.fd = -1;
+    buffer.data = nullptr;
+    buffer.size = 0;
+    buffer.huge_pages = false;
+    buffer.writable = false;
+}
+
+// Create and map a memfd of the given size, returns -1 on failure
+static int createMemfd(size_t size, unsigned int extra_flags, HostBuffer& buffer) {
+    int fd = memfd_create("cuda_vmm_host_buffer", MFD_CLOEXEC | MFD_ALLOW_SEALING | extra_flags);
+    if (fd < 0) {
+        return -1;
+    }
+
+    if (ftruncate(fd, size) < 0) {
+        ::close(fd);
+        return -1;
+    }
+
+    // hugetlbfs reserves pages at mmap time, so failure here means no pool
+    void* data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        ::close(fd);
+        return -1;
+    }
+
+    buffer.fd = fd;
+    buffer.data = data;
+    buffer.size = size;
+    buffer.writable = true;
+    return 0;
+}
+
+int createHostBuffer(size_t size, bool use_huge_pages, HostBuffer& buffer) {
+    resetHostBuffer(buffer);
+
+    if (use_huge_pages) {
+        size_t huge_size = ((size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE) * HUGE_PAGE_SIZE;
+        if (createMemfd(huge_size, MFD_HUGETLB, buffer) == 0) {
+            buffer.huge_pages = true;
+            return 0;
+        }
+        fprintf(stderr, "Huge page memfd unavailable (%s), falling back to regular pages\n",
+                strerror(errno));
+    }
+
+    if (createMemfd(size, 0, buffer) < 0) {
+        fprintf(stderr, "Failed to create host buffer: %s\n", strerror(errno));
+        return -1;
+    }
+
+    if (use_huge_pages) {
+        // Best effort: transparent huge pages for shmem, if enabled
+        madvise(buffer.data, buffer.size, MADV_HUGEPAGE);
+    }
+    return 0;
+}
+
+int sealHostBuffer(HostBuffer& buffer) {
+    // F_SEAL_WRITE fails with EBUSY while any writable shared mapping exists
+    if (buffer.writable) {
+        munmap(buffer.data, buffer.size);
+        buffer.data = nullptr;
+        buffer.writable = false;
+    }
+
+    if (fcntl(buffer.fd, F_ADD_SEALS, REQUIRED_SEALS | F_SEAL_SEAL) < 0) {
+        fprintf(stderr, "Failed to seal host buffer: %s\n", strerror(errno));
+        return -1;
+    }
+
+    void* data = mmap(NULL, buffer.size, PROT_READ, MAP_SHARED, buffer.fd, 0);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "Failed to remap sealed host buffer: %s\n", strerror(errno));
+        return -1;
+    }
+    buffer.data = data;
+    return 0;
+}
+
+int mapHostBufferReadOnly(int fd, size_t size, HostBuffer& buffer) {
+    resetHostBuffer(buffer);
+
+    // Only accept buffers the producer can no longer modify
+    int seals = fcntl(fd, F_GET_SEALS);
+    if (seals < 0 || (seals & REQUIRED_SEALS) != REQUIRED_SEALS) {
+        fprintf(stderr, "Rejected host buffer FD %d: not sealed read-only\n", fd);
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < size) {
+        fprintf(stderr, "Host buffer FD %d is smaller than announced size %zu\n", fd, size);
+        return -1;
+    }
+
+    void* data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "Failed to map host buffer: %s\n", strerror(errno));
+        return -1;
+    }
+
+    buffer.fd = fd;
+    buffer.data = data;
+    buffer.size = size;
+    return 0;
+}
+
+void destroyHostBuffer(HostBuffer& buffer) {
+    if (buffer.data) {
+        munmap(buffer.data, buffer.size);
+    }
+    if (buffer.fd >= 0) {
+        ::close(buffer.fd);
+    }
+    resetHostBuffer(buffer);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+
+// Host memory buffer backed by a memfd, shared through IPCSocket::send_fd.
+// The producer fills it, then seals it; consumers can only map it read-only,
+// mirroring the read-only export semantics enforced by the wrapper.
+struct HostBuffer {
+    int fd;
+    void* data;
+    size_t size;
+    bool huge_pages;
+    bool writable;
+};
+
+// Producer side: create a writable memfd buffer (huge pages if requested and
+// available, falling back to regular pages)
+int createHostBuffer(size_t size, bool use_huge_pages, HostBuffer& buffer);
+
+// Producer side: drop the writable mapping and seal the memfd against
+// writes, growth and shrinking. The buffer is remapped read-only.
+int sealHostBuffer(HostBuffer& buffer);
+
+// Consumer side: map a received memfd read-only (rejects unsealed buffers)
+int mapHostBufferReadOnly(int fd, size_t size, HostBuffer& buffer);
+
+void destroyHostBuffer(HostBuffer& buffer);
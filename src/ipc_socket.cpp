@@ -1,4 +1,5 @@
 #include "ipc_socket.h"
+#include "handoff_trace.h"
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <unistd.h>
@@ -6,18 +7,23 @@
 #include <cstdio>
 #include <cerrno>
 
-constexpr const char* SOCKET_PATH = "/tmp/cuda_vmm_test.sock";
+std::string shardSocketPath(size_t index) {
+    return std::string(DEFAULT_SOCKET_PATH) + "." + std::to_string(index);
+}
 
-IPCSocket::IPCSocket() : socket_fd_(-1), connection_fd_(-1) {}
+IPCSocket::IPCSocket(const std::string& path)
+    : path_(path), listening_(false), socket_fd_(-1), connection_fd_(-1) {}
 
 IPCSocket::~IPCSocket() {
     close_connection();
-    unlink(SOCKET_PATH);
+    if (listening_) {
+        unlink(path_.c_str());
+    }
 }
 
 int IPCSocket::create_and_listen() {
     // Remove old socket file if exists
-    unlink(SOCKET_PATH);
+    unlink(path_.c_str());
 
     // Create Unix domain socket
     socket_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
@@ -29,7 +35,7 @@ int IPCSocket::create_and_listen() {
     // Bind to socket path
     struct sockaddr_un addr = {};
     addr.sun_family = AF_UNIX;
-    strncpy(addr.sun_path, SOCKET_PATH, sizeof(addr.sun_path) - 1);
+    strncpy(addr.sun_path, path_.c_str(), sizeof(addr.sun_path) - 1);
 
     if (bind(socket_fd_, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
         fprintf(stderr, "Failed to bind socket: %s\n", strerror(errno));
@@ -44,6 +50,7 @@ int IPCSocket::create_and_listen() {
         return -1;
     }
 
+    listening_ = true;
     return 0;
 }
 
@@ -56,7 +63,7 @@ int IPCSocket::accept_connection() {
     return 0;
 }
 
-int IPCSocket::connect_to_server() {
+int IPCSocket::connect_to_server(int retry_ms) {
     // Create socket
     socket_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
     if (socket_fd_ < 0) {
@@ -67,12 +74,19 @@ int IPCSocket::connect_to_server() {
     // Connect to server
     struct sockaddr_un addr = {};
     addr.sun_family = AF_UNIX;
-    strncpy(addr.sun_path, SOCKET_PATH, sizeof(addr.sun_path) - 1);
+    strncpy(addr.sun_path, path_.c_str(), sizeof(addr.sun_path) - 1);
 
-    if (connect(socket_fd_, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
-        fprintf(stderr, "Failed to connect to server: %s\n", strerror(errno));
-        ::close(socket_fd_);
-        return -1;
+    // Socket missing or not yet listening: the producer is still starting
+    int waited_ms = 0;
+    while (connect(socket_fd_, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        if ((errno != ENOENT && errno != ECONNREFUSED) || waited_ms >= retry_ms) {
+            fprintf(stderr, "Failed to connect to server: %s\n", strerror(errno));
+            ::close(socket_fd_);
+            socket_fd_ = -1;
+            return -1;
+        }
+        usleep(1000);
+        waited_ms += 1;
     }
 
     connection_fd_ = socket_fd_;
@@ -132,6 +146,55 @@ int IPCSocket::recv_fd(int& fd) {
     return 0;
 }
 
+int IPCSocket::send_optional_fd(int fd) {
+    if (fd >= 0) {
+        return send_fd(fd);
+    }
+
+    // Same one-byte message as send_fd, minus the control message
+    char none = 'N';
+    if (send(connection_fd_, &none, sizeof(none), 0) != sizeof(none)) {
+        fprintf(stderr, "Failed to send empty FD message: %s\n", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+int IPCSocket::recv_optional_fd(int& fd) {
+    struct msghdr msg = {};
+    struct cmsghdr *cmsg;
+    char buf[CMSG_SPACE(sizeof(int))];
+    char marker;
+    struct iovec io = {.iov_base = &marker, .iov_len = sizeof(marker)};
+
+    msg.msg_iov = &io;
+    msg.msg_iovlen = 1;
+    msg.msg_control = buf;
+    msg.msg_controllen = sizeof(buf);
+
+    if (recvmsg(connection_fd_, &msg, 0) < 0) {
+        fprintf(stderr, "Failed to receive FD: %s\n", strerror(errno));
+        return -1;
+    }
+
+    cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg == NULL) {
+        if (marker != 'N') {
+            fprintf(stderr, "Invalid control message\n");
+            return -1;
+        }
+        fd = -1;
+        return 0;
+    }
+    if (cmsg->cmsg_type != SCM_RIGHTS) {
+        fprintf(stderr, "Invalid control message\n");
+        return -1;
+    }
+
+    memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+    return 0;
+}
+
 int IPCSocket::send_metadata(size_t size) {
     if (send(connection_fd_, &size, sizeof(size), 0) != sizeof(size)) {
         fprintf(stderr, "Failed to send metadata: %s\n", strerror(errno));
@@ -148,24 +211,104 @@ int IPCSocket::recv_metadata(size_t& size) {
     return 0;
 }
 
-int IPCSocket::send_ack() {
-    char ack = 'A';
-    if (send(connection_fd_, &ack, 1, 0) != 1) {
-        fprintf(stderr, "Failed to send ACK: %s\n", strerror(errno));
+int IPCSocket::send_generation(uint64_t generation) {
+    if (send(connection_fd_, &generation, sizeof(generation), 0) != sizeof(generation)) {
+        fprintf(stderr, "Failed to send generation: %s\n", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+int IPCSocket::recv_generation(uint64_t& generation) {
+    if (recv(connection_fd_, &generation, sizeof(generation), 0) != sizeof(generation)) {
+        fprintf(stderr, "Failed to receive generation: %s\n", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+int IPCSocket::send_announcement(const BufferAnnouncement& announcement) {
+    BufferAnnouncement message = announcement;
+    message.sent_ns = handoffTraceNow();
+    if (send(connection_fd_, &message, sizeof(message), 0) != sizeof(message)) {
+        fprintf(stderr, "Failed to send announcement: %s\n", strerror(errno));
+        return -1;
+    }
+    handoffTraceSend("announcement", message.sent_ns);
+    return 0;
+}
+
+int IPCSocket::recv_announcement(BufferAnnouncement& announcement) {
+    if (recv(connection_fd_, &announcement, sizeof(announcement), MSG_WAITALL) != sizeof(announcement)) {
+        fprintf(stderr, "Failed to receive announcement: %s\n", strerror(errno));
+        return -1;
+    }
+    handoffTraceReceive("announcement", announcement.sent_ns);
+    return 0;
+}
+
+int IPCSocket::send_shard(const ShardAnnouncement& shard) {
+    if (send(connection_fd_, &shard, sizeof(shard), 0) != sizeof(shard)) {
+        fprintf(stderr, "Failed to send shard announcement: %s\n", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+int IPCSocket::recv_shard(ShardAnnouncement& shard) {
+    if (recv(connection_fd_, &shard, sizeof(shard), MSG_WAITALL) != sizeof(shard)) {
+        fprintf(stderr, "Failed to receive shard announcement: %s\n", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+// Signals are a type byte and the sender's CLOCK_MONOTONIC send time
+int IPCSocket::send_signal(char type, const char* what) {
+    char message[1 + sizeof(uint64_t)];
+    const uint64_t sent_ns = handoffTraceNow();
+    message[0] = type;
+    memcpy(message + 1, &sent_ns, sizeof(sent_ns));
+    if (send(connection_fd_, message, sizeof(message), 0) != sizeof(message)) {
+        fprintf(stderr, "Failed to send %s: %s\n", what, strerror(errno));
         return -1;
     }
+    handoffTraceSend(what, sent_ns);
     return 0;
 }
 
-int IPCSocket::wait_ack() {
-    char ack;
-    if (recv(connection_fd_, &ack, 1, 0) != 1) {
-        fprintf(stderr, "Failed to receive ACK: %s\n", strerror(errno));
+int IPCSocket::recv_signal(char type, const char* what, uint64_t* sent_ns) {
+    char message[1 + sizeof(uint64_t)];
+    if (recv(connection_fd_, message, sizeof(message), MSG_WAITALL) != sizeof(message) ||
+        message[0] != type) {
+        fprintf(stderr, "Failed to receive %s: %s\n", what, strerror(errno));
         return -1;
     }
+    uint64_t sent;
+    memcpy(&sent, message + 1, sizeof(sent));
+    handoffTraceReceive(what, sent);
+    if (sent_ns) {
+        *sent_ns = sent;
+    }
     return 0;
 }
 
+int IPCSocket::send_ready() {
+    return send_signal('R', "data-ready signal");
+}
+
+int IPCSocket::wait_ready(uint64_t* sent_ns) {
+    return recv_signal('R', "data-ready signal", sent_ns);
+}
+
+int IPCSocket::send_ack() {
+    return send_signal('A', "ACK");
+}
+
+int IPCSocket::wait_ack(uint64_t* sent_ns) {
+    return recv_signal('A', "ACK", sent_ns);
+}
+
 void IPCSocket::close_connection() {
     if (connection_fd_ >= 0 && connection_fd_ != socket_fd_) {
         ::close(connection_fd_);
@@ -1,34 +1,86 @@
 #pragma once
 
+#include "tensor_desc.h"
 #include <cstddef>
+#include <cstdint>
+#include <string>
+
+constexpr const char* DEFAULT_SOCKET_PATH = "/tmp/cuda_vmm_test.sock";
+
+// Socket of shard `index` in a multi-producer gather ("<default>.<index>")
+std::string shardSocketPath(size_t index);
+
+// Buffer metadata announced before the data is ready, so the consumer can
+// reserve VA and prepare access while the producer is still filling it
+struct BufferAnnouncement {
+    uint64_t aligned_size;
+    uint64_t buffer_size;
+    uint64_t producer_start_ns;  // CLOCK_MONOTONIC, for end-to-end timing
+    uint64_t sent_ns;            // CLOCK_MONOTONIC at send (set by send_announcement)
+    TensorDescriptor tensor;     // Element type and layout of the buffer's contents
+};
+
+// Where one producer's shard sits in the logical buffer a consumer gathers
+struct ShardAnnouncement {
+    uint32_t shard_index;
+    uint32_t shard_count;
+    uint64_t offset;             // Byte offset in the gathered view (granularity aligned)
+    uint64_t size;               // Aligned size of this shard's allocation
+    uint64_t total_size;         // Size of the whole view
+};
 
 class IPCSocket {
 public:
-    IPCSocket();
+    explicit IPCSocket(const std::string& path = DEFAULT_SOCKET_PATH);
     ~IPCSocket();
 
     // Server side (producer)
     int create_and_listen();
     int accept_connection();
 
-    // Client side (consumer)
-    int connect_to_server();
+    // Client side (consumer); retries for up to retry_ms while the
+    // producer is still starting
+    int connect_to_server(int retry_ms = 0);
 
     // File descriptor passing via SCM_RIGHTS
     int send_fd(int fd);
     int recv_fd(int& fd);
 
+    // FD that may be absent (fd < 0 sends/receives "none")
+    int send_optional_fd(int fd);
+    int recv_optional_fd(int& fd);
+
     // Metadata (size) passing
     int send_metadata(size_t size);
     int recv_metadata(size_t& size);
 
-    // Synchronization
+    // Generation number of a versioned buffer
+    int send_generation(uint64_t generation);
+    int recv_generation(uint64_t& generation);
+
+    // Early buffer announcement
+    int send_announcement(const BufferAnnouncement& announcement);
+    int recv_announcement(BufferAnnouncement& announcement);
+
+    // Shard placement for multi-producer gathers
+    int send_shard(const ShardAnnouncement& shard);
+    int recv_shard(ShardAnnouncement& shard);
+
+    // Synchronization; each signal carries the sender's CLOCK_MONOTONIC
+    // send time, returned through sent_ns and recorded as a trace flow
+    int send_ready();
+    int wait_ready(uint64_t* sent_ns = nullptr);
     int send_ack();
-    int wait_ack();
+    int wait_ack(uint64_t* sent_ns = nullptr);
 
     void close_connection();
 
 private:
+    int send_signal(char type, const char* what);
+    int recv_signal(char type, const char* what, uint64_t* sent_ns);
+
+    std::string path_;
+    bool listening_;  // Server side owns (and unlinks) the socket file
     int socket_fd_;
     int connection_fd_;
 };
@@ -1,111 +1,623 @@
 #include "cuda_ipc_common.h"
 #include "ipc_socket.h"
 #include "cuda_ro_wrapper.h"
+#include "host_buffer.h"
+#include "va_arena.h"
+#include "ro_session.h"
+#include "snapshot.h"
+#include "tensor_desc.h"
+#include "handoff_trace.h"
 #include <vector>
+#include <cstring>
 #include <unistd.h>
 
-int main() {
-    printf("=== CUDA VMM Producer ===\n");
+// Share a sealed memfd host buffer instead of GPU memory (no CUDA needed)
+static int runHostProducer(size_t buffer_size, bool use_huge_pages) {
+    printf("=== Host Buffer Producer ===\n");
 
-    // 1. Initialize CUDA
+    // 1. Create memfd-backed host buffer
+    HostBuffer host_buffer;
+    if (createHostBuffer(buffer_size, use_huge_pages, host_buffer) < 0) {
+        return 1;
+    }
+    printf("Created host buffer: %zu bytes, huge pages: %s\n",
+           host_buffer.size, host_buffer.huge_pages ? "yes" : "no");
+
+    // 2. Generate test data in place
+    const size_t element_count = buffer_size / sizeof(int);
+    generateTestData(static_cast<int*>(host_buffer.data), element_count);
+    printf("Generated %zu test integers\n", element_count);
+
+    // 3. Seal read-only before sharing
+    if (sealHostBuffer(host_buffer) < 0) {
+        return 1;
+    }
+    printf("Sealed host buffer FD %d (read-only)\n", host_buffer.fd);
+
+    // 4. Setup IPC socket and accept consumer
+    IPCSocket ipc_sock;
+    if (ipc_sock.create_and_listen() < 0) {
+        fprintf(stderr, "Failed to create IPC socket\n");
+        return 1;
+    }
+    printf("Waiting for consumer connection...\n");
+    if (ipc_sock.accept_connection() < 0) {
+        fprintf(stderr, "Failed to accept consumer\n");
+        return 1;
+    }
+    printf("Consumer connected\n");
+
+    // 5. Send FD and metadata (the data size; the memfd may be rounded up
+    //    to whole huge pages)
+    if (ipc_sock.send_fd(host_buffer.fd) < 0) {
+        fprintf(stderr, "Failed to send FD\n");
+        return 1;
+    }
+    if (ipc_sock.send_metadata(buffer_size) < 0) {
+        fprintf(stderr, "Failed to send metadata\n");
+        return 1;
+    }
+    printf("Sent FD and size metadata to consumer\n");
+
+    // 6. Wait for consumer ACK
+    if (ipc_sock.wait_ack() < 0) {
+        fprintf(stderr, "Failed to receive ACK\n");
+        return 1;
+    }
+    printf("Consumer verified data successfully!\n");
+
+    // 7. Cleanup
+    destroyHostBuffer(host_buffer);
+    printf("Cleanup complete\n");
+
+    return 0;
+}
+
+// Publish successive generations of the buffer, each in a new physical handle
+static int runGenerationsProducer(size_t buffer_size, int generations) {
+    printf("=== CUDA VMM Versioned Producer (%d generations) ===\n", generations);
+    handoffTraceInit("producer");
+
+    // 1. Initialize CUDA and allocation properties
     CUdevice device = initCudaDevice(0);
-    CUcontext context = createCudaContext(device);
+    createCudaContext(device);
+    if (!checkVMMSupport(device)) {
+        return 1;
+    }
+    size_t granularity = getMemoryGranularity(device);
+    const size_t aligned_size = alignSize(buffer_size, granularity);
+    VAArena& arena = VAArena::getInstance();
+    if (arena.init(VAArena::configuredSize(), granularity) < 0) {
+        return 1;
+    }
+
+    CUmemAllocationProp prop = {};
+    prop.type = CU_MEM_ALLOCATION_TYPE_PINNED;
+    prop.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+    prop.location.id = device;
+    prop.requestedHandleTypes = CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR;
+
+    CUmemAccessDesc accessDesc = {};
+    accessDesc.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+    accessDesc.location.id = device;
+    accessDesc.flags = CU_MEM_ACCESS_FLAGS_PROT_READWRITE;
+
+    // 2. Accept consumer
+    IPCSocket ipc_sock;
+    if (ipc_sock.create_and_listen() < 0) {
+        fprintf(stderr, "Failed to create IPC socket\n");
+        return 1;
+    }
+    printf("Waiting for consumer connection...\n");
+    if (ipc_sock.accept_connection() < 0) {
+        fprintf(stderr, "Failed to accept consumer\n");
+        return 1;
+    }
+    printf("Consumer connected\n");
+    if (sendReadOnlyRegistry(ipc_sock) < 0) {
+        fprintf(stderr, "Failed to send read-only registry\n");
+        return 1;
+    }
 
-    // 2. Check VMM support
+    const size_t element_count = buffer_size / sizeof(int);
+    std::vector<int> h_buffer(element_count);
+    BufferAnnouncement announcement = {aligned_size, buffer_size, monotonicNowNs(), 0,
+                                       makeTensorDescriptor(TensorDType::Int32,
+                                                            {(int64_t)element_count})};
+
+    for (int generation = 0; generation < generations; ++generation) {
+        // 3. Fill a fresh physical allocation through a temporary mapping
+        HandoffSpan fill_span("create + fill");
+        CUmemGenericAllocationHandle alloc_handle;
+        CUdeviceptr dptr;
+        CHECK_CUDA(cuMemCreate(&alloc_handle, aligned_size, &prop, 0));
+        dptr = arena.allocate(aligned_size);
+        if (dptr == 0) {
+            fprintf(stderr, "VA arena exhausted\n");
+            CHECK_CUDA(cuMemRelease(alloc_handle));
+            return 1;
+        }
+        CHECK_CUDA(cuMemMap(dptr, aligned_size, 0, alloc_handle, 0));
+        CHECK_CUDA(cuMemSetAccess(dptr, aligned_size, &accessDesc, 1));
+
+        generateTestData(h_buffer.data(), element_count, generation);
+        copyHostToDevice(dptr, h_buffer.data(), buffer_size);
+        CHECK_CUDA(cuMemUnmap(dptr, aligned_size));
+        arena.free(dptr);
+        fill_span.end();
+
+        // 4. Export and publish generation
+        HandoffSpan publish_span("export + publish");
+        int fd;
+        CHECK_CUDA(cuMemExportToShareableHandle((void*)&fd, alloc_handle,
+            CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR, CU_MEM_EXPORT_FLAGS_READONLY));
+        if (ipc_sock.send_fd(fd) < 0 ||
+            ipc_sock.send_announcement(announcement) < 0 ||
+            ipc_sock.send_generation(generation) < 0) {
+            fprintf(stderr, "Failed to publish generation %d\n", generation);
+            return 1;
+        }
+        publish_span.end();
+
+        // 5. Consumer holds its own reference once it has imported and verified
+        HandoffSpan ack_span("wait ack");
+        if (ipc_sock.wait_ack() < 0) {
+            fprintf(stderr, "Failed to receive ACK\n");
+            return 1;
+        }
+        ack_span.end();
+        printf("Generation %d published and verified\n", generation);
+        ::close(fd);
+        CHECK_CUDA(cuMemRelease(alloc_handle));
+    }
+
+    arena.printStats("producer");
+    arena.destroy();
+    CHECK_CUDA(cuDevicePrimaryCtxRelease(device));
+    printf("Cleanup complete\n");
+    return 0;
+}
+
+// Publish one shard of a logical buffer gathered by a multi-producer consumer
+static int runShardProducer(size_t buffer_size, size_t shard_index, size_t shard_count) {
+    printf("=== CUDA VMM Shard Producer (%zu of %zu) ===\n", shard_index, shard_count);
+
+    // 1. Initialize CUDA; every shard fills whole granules so the gathered
+    //    view is dense
+    CUdevice device = initCudaDevice(0);
+    createCudaContext(device);
     if (!checkVMMSupport(device)) {
         return 1;
     }
+    size_t granularity = getMemoryGranularity(device);
+    const size_t shard_size = alignSize(buffer_size, granularity);
+    const size_t offset = shard_index * shard_size;
+
+    // 2. Create, map and fill this shard
+    CUmemAllocationProp prop = {};
+    prop.type = CU_MEM_ALLOCATION_TYPE_PINNED;
+    prop.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+    prop.location.id = device;
+    prop.requestedHandleTypes = CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR;
 
-    // 3. Get memory granularity
+    CUmemGenericAllocationHandle alloc_handle;
+    CHECK_CUDA(cuMemCreate(&alloc_handle, shard_size, &prop, 0));
+    VAArena& arena = VAArena::getInstance();
+    if (arena.init(VAArena::configuredSize(), granularity) < 0) {
+        return 1;
+    }
+    CUdeviceptr dptr = arena.allocate(shard_size);
+    if (dptr == 0) {
+        fprintf(stderr, "VA arena exhausted\n");
+        return 1;
+    }
+    CHECK_CUDA(cuMemMap(dptr, shard_size, 0, alloc_handle, 0));
+
+    CUmemAccessDesc accessDesc = {};
+    accessDesc.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+    accessDesc.location.id = device;
+    accessDesc.flags = CU_MEM_ACCESS_FLAGS_PROT_READWRITE;
+    CHECK_CUDA(cuMemSetAccess(dptr, shard_size, &accessDesc, 1));
+
+    const size_t element_count = shard_size / sizeof(int);
+    std::vector<int> h_buffer(element_count);
+    generateTestData(h_buffer.data(), element_count, 0, offset / sizeof(int));
+    copyHostToDevice(dptr, h_buffer.data(), shard_size);
+    printf("Filled shard at offset %zu (%zu bytes)\n", offset, shard_size);
+
+    int fd;
+    CHECK_CUDA(cuMemExportToShareableHandle((void*)&fd, alloc_handle,
+        CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR, CU_MEM_EXPORT_FLAGS_READONLY));
+
+    // 3. Serve the shard on its own socket
+    IPCSocket ipc_sock(shardSocketPath(shard_index));
+    if (ipc_sock.create_and_listen() < 0) {
+        fprintf(stderr, "Failed to create IPC socket\n");
+        return 1;
+    }
+    printf("Waiting for consumer connection...\n");
+    if (ipc_sock.accept_connection() < 0) {
+        fprintf(stderr, "Failed to accept consumer\n");
+        return 1;
+    }
+    ShardAnnouncement shard = {(uint32_t)shard_index, (uint32_t)shard_count, offset, shard_size,
+                               shard_count * shard_size};
+    if (sendReadOnlyRegistry(ipc_sock) < 0 ||
+        ipc_sock.send_shard(shard) < 0 ||
+        ipc_sock.send_fd(fd) < 0) {
+        fprintf(stderr, "Failed to publish shard\n");
+        return 1;
+    }
+    printf("Sent shard %zu to consumer\n", shard_index);
+
+    // 4. Wait for the consumer to verify the whole gathered view
+    if (ipc_sock.wait_ack() < 0) {
+        fprintf(stderr, "Failed to receive ACK\n");
+        return 1;
+    }
+    printf("Consumer verified gathered view\n");
+
+    // 5. Cleanup
+    ::close(fd);
+    CHECK_CUDA(cuMemUnmap(dptr, shard_size));
+    arena.free(dptr);
+    arena.destroy();
+    CHECK_CUDA(cuMemRelease(alloc_handle));
+    CHECK_CUDA(cuDevicePrimaryCtxRelease(device));
+    printf("Cleanup complete\n");
+    return 0;
+}
+
+// Export many separate buffers over one connection; the consumer attaches
+// them all at once with batchAttach
+static int runBatchProducer(size_t buffer_size, size_t buffer_count) {
+    printf("=== CUDA VMM Batch Producer (%zu buffers) ===\n", buffer_count);
+
+    // 1. Initialize CUDA
+    CUdevice device = initCudaDevice(0);
+    createCudaContext(device);
+    if (!checkVMMSupport(device)) {
+        return 1;
+    }
     size_t granularity = getMemoryGranularity(device);
+    const size_t aligned_size = alignSize(buffer_size, granularity);
 
-    // 4. Setup allocation properties
+    // 2. Create, fill and export every buffer through one scratch mapping;
+    //    buffer i is seeded with i so a swapped FD fails verification
     CUmemAllocationProp prop = {};
     prop.type = CU_MEM_ALLOCATION_TYPE_PINNED;
     prop.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
     prop.location.id = device;
     prop.requestedHandleTypes = CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR;
 
-    // 5. Allocate and align size
+    CUmemAccessDesc accessDesc = {};
+    accessDesc.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+    accessDesc.location.id = device;
+    accessDesc.flags = CU_MEM_ACCESS_FLAGS_PROT_READWRITE;
+
+    VAArena& arena = VAArena::getInstance();
+    if (arena.init(VAArena::configuredSize(), granularity) < 0) {
+        return 1;
+    }
+    CUdeviceptr dptr = arena.allocate(aligned_size);
+    if (dptr == 0) {
+        fprintf(stderr, "VA arena exhausted\n");
+        return 1;
+    }
+
+    const size_t element_count = buffer_size / sizeof(int);
+    std::vector<int> h_buffer(element_count);
+    std::vector<CUmemGenericAllocationHandle> handles(buffer_count);
+    std::vector<int> fds(buffer_count);
+    for (size_t i = 0; i < buffer_count; ++i) {
+        CHECK_CUDA(cuMemCreate(&handles[i], aligned_size, &prop, 0));
+        CHECK_CUDA(cuMemMap(dptr, aligned_size, 0, handles[i], 0));
+        CHECK_CUDA(cuMemSetAccess(dptr, aligned_size, &accessDesc, 1));
+        generateTestData(h_buffer.data(), element_count, (uint32_t)i);
+        copyHostToDevice(dptr, h_buffer.data(), buffer_size);
+        CHECK_CUDA(cuMemUnmap(dptr, aligned_size));
+        CHECK_CUDA(cuMemExportToShareableHandle((void*)&fds[i], handles[i],
+            CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR, CU_MEM_EXPORT_FLAGS_READONLY));
+    }
+    arena.free(dptr);
+    printf("Filled and exported %zu buffers of %zu bytes\n", buffer_count, buffer_size);
+
+    // 3. Send the count and logical size, then one FD and aligned size per buffer
+    IPCSocket ipc_sock;
+    if (ipc_sock.create_and_listen() < 0) {
+        fprintf(stderr, "Failed to create IPC socket\n");
+        return 1;
+    }
+    printf("Waiting for consumer connection...\n");
+    if (ipc_sock.accept_connection() < 0) {
+        fprintf(stderr, "Failed to accept consumer\n");
+        return 1;
+    }
+    if (sendReadOnlyRegistry(ipc_sock) < 0 ||
+        ipc_sock.send_metadata(buffer_count) < 0 ||
+        ipc_sock.send_metadata(buffer_size) < 0) {
+        fprintf(stderr, "Failed to send batch metadata\n");
+        return 1;
+    }
+    for (size_t i = 0; i < buffer_count; ++i) {
+        if (ipc_sock.send_fd(fds[i]) < 0 || ipc_sock.send_metadata(aligned_size) < 0) {
+            fprintf(stderr, "Failed to send buffer %zu\n", i);
+            return 1;
+        }
+    }
+    printf("Sent %zu buffers to consumer\n", buffer_count);
+
+    // 4. Wait for the consumer to verify every buffer
+    if (ipc_sock.wait_ack() < 0) {
+        fprintf(stderr, "Failed to receive ACK\n");
+        return 1;
+    }
+    printf("Consumer verified all buffers\n");
+
+    // 5. Cleanup
+    for (size_t i = 0; i < buffer_count; ++i) {
+        ::close(fds[i]);
+        CHECK_CUDA(cuMemRelease(handles[i]));
+    }
+    arena.destroy();
+    CHECK_CUDA(cuDevicePrimaryCtxRelease(device));
+    printf("Cleanup complete\n");
+    return 0;
+}
+
+int main(int argc, char** argv) {
     const size_t buffer_size = 1024 * 1024; // 1MB
+    bool serial = false;
+    const char* snapshot_path = nullptr;
+    const char* restore_path = nullptr;
+    TensorDType dtype = TensorDType::Int32;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--serial") == 0) {
+            serial = true;
+        } else if (strcmp(argv[i], "--snapshot") == 0 && i + 1 < argc) {
+            snapshot_path = argv[++i];
+        } else if (strcmp(argv[i], "--restore") == 0 && i + 1 < argc) {
+            restore_path = argv[++i];
+        } else if (strcmp(argv[i], "--dtype") == 0 && i + 1 < argc) {
+            if (parseTensorDType(argv[++i], dtype) < 0) {
+                fprintf(stderr, "--dtype expects int32, float32, float16, int8 or uint8\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--host") == 0) {
+            return runHostProducer(buffer_size, false);
+        } else if (strcmp(argv[i], "--host-huge") == 0) {
+            return runHostProducer(buffer_size, true);
+        } else if (strcmp(argv[i], "--generations") == 0 && i + 1 < argc) {
+            return runGenerationsProducer(buffer_size, atoi(argv[i + 1]));
+        } else if (strcmp(argv[i], "--shard") == 0 && i + 1 < argc) {
+            size_t index, count;
+            if (sscanf(argv[i + 1], "%zu/%zu", &index, &count) != 2 || index >= count) {
+                fprintf(stderr, "--shard expects INDEX/COUNT\n");
+                return 1;
+            }
+            return runShardProducer(buffer_size, index, count);
+        } else if (strcmp(argv[i], "--buffers") == 0 && i + 1 < argc) {
+            size_t count = strtoul(argv[i + 1], NULL, 10);
+            if (count == 0) {
+                fprintf(stderr, "--buffers expects a positive count\n");
+                return 1;
+            }
+            return runBatchProducer(buffer_size, count);
+        } else {
+            fprintf(stderr, "Usage: %s [--serial] [--snapshot FILE] [--restore FILE] [--dtype T] | --host | "
+                    "--host-huge | --generations N | --shard I/N | --buffers N\n", argv[0]);
+            return 1;
+        }
+    }
+
+    const uint64_t start_ns = monotonicNowNs();
+    handoffTraceInit("producer");
+    printf("=== CUDA VMM Producer%s ===\n", serial ? " (serial startup)" : "");
+
+    // 1. Start listening immediately; the consumer's connect completes
+    //    against the listen backlog while we set up
+    IPCSocket ipc_sock;
+    auto listen = [&]() {
+        HandoffSpan span("listen");
+        if (ipc_sock.create_and_listen() < 0) {
+            fprintf(stderr, "Failed to create IPC socket\n");
+            return false;
+        }
+        printf("Waiting for consumer connection...\n");
+        return true;
+    };
+    if (!serial && !listen()) {
+        return 1;
+    }
+
+    // 2. Initialize CUDA
+    HandoffSpan init_span("cuda init");
+    CUdevice device = initCudaDevice(0);
+    createCudaContext(device);
+
+    // 3. Check VMM support
+    if (!checkVMMSupport(device)) {
+        return 1;
+    }
+
+    // 4. Get memory granularity
+    size_t granularity = getMemoryGranularity(device);
+    init_span.end();
+
+    // 5. Setup allocation properties
+    CUmemAllocationProp prop = {};
+    prop.type = CU_MEM_ALLOCATION_TYPE_PINNED;
+    prop.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+    prop.location.id = device;
+    prop.requestedHandleTypes = CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR;
+
+    // 6. Align size
     const size_t aligned_size = alignSize(buffer_size, granularity);
     printf("Buffer size: %zu bytes, aligned size: %zu bytes\n", buffer_size, aligned_size);
 
-    // 6. Create physical memory allocation
+    // 7. Announce buffer metadata as soon as the size is known: a row-major
+    //    [rows, 1024] tensor of the chosen element type filling the buffer
+    const int64_t columns = 1024;
+    const int64_t rows = buffer_size / (columns * tensorDTypeSize(dtype));
+    BufferAnnouncement announcement = {aligned_size, buffer_size, start_ns, 0,
+                                       makeTensorDescriptor(dtype, {rows, columns})};
+    printf("Tensor: %s [%lld, %lld]\n", tensorDTypeName(dtype), (long long)rows, (long long)columns);
+    auto announce = [&]() {
+        HandoffSpan accept_span("accept");
+        if (ipc_sock.accept_connection() < 0) {
+            fprintf(stderr, "Failed to accept consumer\n");
+            return false;
+        }
+        accept_span.end();
+        printf("Consumer connected\n");
+        HandoffSpan announce_span("send registry + announcement");
+        if (sendReadOnlyRegistry(ipc_sock) < 0) {
+            fprintf(stderr, "Failed to send read-only registry\n");
+            return false;
+        }
+        if (ipc_sock.send_announcement(announcement) < 0) {
+            fprintf(stderr, "Failed to send announcement\n");
+            return false;
+        }
+        printf("Announced buffer metadata to consumer\n");
+        return true;
+    };
+    if (!serial && !announce()) {
+        return 1;
+    }
+
+    // 8. Create physical memory allocation
+    HandoffSpan create_span("create");
     CUmemGenericAllocationHandle alloc_handle;
     CHECK_CUDA(cuMemCreate(&alloc_handle, aligned_size, &prop, 0));
+    create_span.end();
     printf("Created physical memory allocation\n");
 
-    // 7. Reserve virtual address space
-    CUdeviceptr dptr;
-    CHECK_CUDA(cuMemAddressReserve(&dptr, aligned_size, 0, 0, 0));
+    // 9. Reserve virtual address space from the process arena
+    HandoffSpan map_span("reserve + map");
+    VAArena& arena = VAArena::getInstance();
+    if (arena.init(VAArena::configuredSize(), granularity) < 0) {
+        return 1;
+    }
+    CUdeviceptr dptr = arena.allocate(aligned_size);
+    if (dptr == 0) {
+        fprintf(stderr, "VA arena exhausted\n");
+        return 1;
+    }
     printf("Reserved virtual address space at 0x%llx\n", (unsigned long long)dptr);
 
-    // 8. Map physical memory to virtual address
+    // 10. Map physical memory to virtual address
     CHECK_CUDA(cuMemMap(dptr, aligned_size, 0, alloc_handle, 0));
     printf("Mapped physical memory to virtual address\n");
 
-    // 9. Set access permissions
+    // 11. Set access permissions
     CUmemAccessDesc accessDesc = {};
     accessDesc.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
     accessDesc.location.id = device;
     accessDesc.flags = CU_MEM_ACCESS_FLAGS_PROT_READWRITE;
     CHECK_CUDA(cuMemSetAccess(dptr, aligned_size, &accessDesc, 1));
+    map_span.end();
     printf("Set read/write access permissions\n");
 
-    // 10. Generate test data
-    const size_t element_count = buffer_size / sizeof(int);
-    std::vector<int> h_buffer(element_count);
-    generateTestData(h_buffer.data(), element_count);
-    printf("Generated %zu test integers\n", element_count);
-
-    // 11. Copy data to GPU
-    copyHostToDevice(dptr, h_buffer.data(), buffer_size);
-    printf("Copied test data to GPU\n");
-
-    // 12. Export as file descriptor (read-only)
+    // 12. Export as file descriptor (read-only) and send it before the data
+    //     exists, so the consumer can import and map in parallel
+    HandoffSpan export_span("export");
     int fd;
     CHECK_CUDA(cuMemExportToShareableHandle((void*)&fd, alloc_handle,
         CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR, CU_MEM_EXPORT_FLAGS_READONLY));
+    export_span.end();
     printf("Exported allocation as FD: %d (read-only)\n", fd);
+    if (!serial) {
+        HandoffSpan send_span("sendmsg fd");
+        if (ipc_sock.send_fd(fd) < 0) {
+            fprintf(stderr, "Failed to send FD\n");
+            return 1;
+        }
+        printf("Sent FD to consumer\n");
+    }
 
-    // 13. Setup IPC socket
-    IPCSocket ipc_sock;
-    if (ipc_sock.create_and_listen() < 0) {
-        fprintf(stderr, "Failed to create IPC socket\n");
-        return 1;
+    // 13. Restore the data from a snapshot when one matches this buffer
+    bool restored = false;
+    if (restore_path) {
+        HandoffSpan restore_span("restore");
+        uint64_t restore_start = monotonicNowNs();
+        SnapshotReader snapshot;
+        if (snapshot.open(restore_path) == 0 && snapshot.bufferCount() == 1 &&
+            snapshot.buffer(0).size == buffer_size &&
+            snapshot.buffer(0).aligned_size == aligned_size &&
+            tensorDescriptorsEqual(snapshot.buffer(0).tensor, announcement.tensor)) {
+            restored = snapshot.upload(0, dptr) == 0;
+        }
+        if (restored) {
+            printf("Restored buffer from snapshot %s in %.2f ms\n", restore_path,
+                   (monotonicNowNs() - restore_start) / 1e6);
+        } else {
+            printf("Snapshot %s unusable, regenerating data\n", restore_path);
+        }
     }
-    printf("Waiting for consumer connection...\n");
 
-    // 14. Accept consumer connection
-    if (ipc_sock.accept_connection() < 0) {
-        fprintf(stderr, "Failed to accept consumer\n");
-        return 1;
+    // 14. Otherwise generate test data and copy it to the GPU
+    if (!restored) {
+        HandoffSpan generate_span("generate");
+        std::vector<char> h_buffer(buffer_size);
+        generateTensorData(h_buffer.data(), announcement.tensor);
+        generate_span.end();
+        printf("Generated %zu test %s elements\n", tensorElementCount(announcement.tensor),
+               tensorDTypeName(dtype));
+
+        HandoffSpan copy_span("copy to device");
+        copyHostToDevice(dptr, h_buffer.data(), buffer_size);
+        printf("Copied test data to GPU\n");
     }
-    printf("Consumer connected\n");
 
-    // 15. Send FD and metadata
-    if (ipc_sock.send_fd(fd) < 0) {
-        fprintf(stderr, "Failed to send FD\n");
-        return 1;
+    // 15. Serial startup only talks to the consumer once everything is done
+    if (serial) {
+        if (!listen() || !announce()) {
+            return 1;
+        }
+        HandoffSpan send_span("sendmsg fd");
+        if (ipc_sock.send_fd(fd) < 0) {
+            fprintf(stderr, "Failed to send FD\n");
+            return 1;
+        }
+        printf("Sent FD to consumer\n");
     }
-    if (ipc_sock.send_metadata(aligned_size) < 0) {
-        fprintf(stderr, "Failed to send metadata\n");
+
+    // 16. Signal data ready
+    HandoffSpan ready_span("send ready");
+    if (ipc_sock.send_ready() < 0) {
+        fprintf(stderr, "Failed to signal data ready\n");
         return 1;
     }
-    printf("Sent FD and size metadata to consumer\n");
+    ready_span.end();
+    printf("Data ready after %.2f ms\n", (monotonicNowNs() - start_ns) / 1e6);
+
+    // 17. Snapshot the buffer for the next restart while the consumer reads it
+    if (snapshot_path) {
+        HandoffSpan snapshot_span("snapshot");
+        std::vector<SnapshotSource> sources = {
+            {0, dptr, buffer_size, aligned_size, announcement.tensor}};
+        if (writeSnapshot(snapshot_path, 0, granularity, sources) < 0) {
+            fprintf(stderr, "Failed to write snapshot %s\n", snapshot_path);
+        }
+    }
 
-    // 16. Wait for consumer ACK
+    // 18. Wait for consumer ACK
+    HandoffSpan ack_span("wait ack");
     if (ipc_sock.wait_ack() < 0) {
         fprintf(stderr, "Failed to receive ACK\n");
         return 1;
     }
+    ack_span.end();
     printf("Consumer verified data successfully!\n");
 
-    // 17. Cleanup
+    // 19. Cleanup
+    HandoffSpan cleanup_span("cleanup");
     ::close(fd);
     CHECK_CUDA(cuMemUnmap(dptr, aligned_size));
-    CHECK_CUDA(cuMemAddressFree(dptr, aligned_size));
+    arena.free(dptr);
+    arena.destroy();
     CHECK_CUDA(cuMemRelease(alloc_handle));
     CHECK_CUDA(cuDevicePrimaryCtxRelease(device));
     printf("Cleanup complete\n");
@@ -0,0 +1,36 @@
+#include "ro_session.h"
+#include "cuda_ro_wrapper.h"
+#include <dlfcn.h>
+#include <unistd.h>
+#include <cstdio>
+
+int sendReadOnlyRegistry(IPCSocket& sock) {
+    auto get_fd = (cuRoWrapperGetRegistryFd_t)dlsym(RTLD_DEFAULT, CU_RO_WRAPPER_GET_REGISTRY_FD);
+    int registry_fd = get_fd ? get_fd() : -1;
+
+    int result = sock.send_optional_fd(registry_fd);
+    if (registry_fd >= 0) {
+        ::close(registry_fd);
+    }
+    return result;
+}
+
+int recvReadOnlyRegistry(IPCSocket& sock) {
+    int registry_fd;
+    if (sock.recv_optional_fd(registry_fd) < 0) {
+        return -1;
+    }
+    if (registry_fd < 0) {
+        return 0;  // Producer runs without the wrapper
+    }
+
+    auto attach = (cuRoWrapperAttachRegistry_t)dlsym(RTLD_DEFAULT, CU_RO_WRAPPER_ATTACH_REGISTRY);
+    int result = 0;
+    if (attach) {
+        result = attach(registry_fd);
+    } else {
+        fprintf(stderr, "Producer uses the read-only wrapper but it is not preloaded here\n");
+    }
+    ::close(registry_fd);
+    return result;
+}
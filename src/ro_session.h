@@ -0,0 +1,10 @@
+#pragma once
+
+#include "ipc_socket.h"
+
+// Per-session read-only registry handoff. When the read-only wrapper is
+// preloaded, the producer sends its private registry memfd and the consumer
+// attaches it before importing. Without the wrapper an empty message is
+// exchanged, so both sides keep the same protocol either way.
+int sendReadOnlyRegistry(IPCSocket& sock);
+int recvReadOnlyRegistry(IPCSocket& sock);
@@ -0,0 +1,327 @@
+#include "snapshot.h"
+#include "cuda_ipc_common.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+static const uint64_t CHECKSUM_PRIME1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t CHECKSUM_PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+
+static uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static uint64_t mixLane(uint64_t lane, uint64_t word) {
+    return rotl(lane + word * CHECKSUM_PRIME2, 31) * CHECKSUM_PRIME1;
+}
+
+SnapshotChecksum::SnapshotChecksum() : length(0) {
+    for (int i = 0; i < 4; ++i) {
+        lanes[i] = CHECKSUM_PRIME1 + i * CHECKSUM_PRIME2;
+    }
+}
+
+void SnapshotChecksum::update(const void* data, size_t size) {
+    const unsigned char* p = (const unsigned char*)data;
+    size_t blocks = size / 32;
+    for (size_t b = 0; b < blocks; ++b, p += 32) {
+        uint64_t words[4];
+        memcpy(words, p, sizeof(words));
+        for (int i = 0; i < 4; ++i) {
+            lanes[i] = mixLane(lanes[i], words[i]);
+        }
+    }
+
+    // Tail bytes (only in the final chunk) fold into the lanes zero-padded
+    size_t tail = size % 32;
+    if (tail) {
+        uint64_t words[4] = {0, 0, 0, 0};
+        memcpy(words, p, tail);
+        for (int i = 0; i < 4; ++i) {
+            lanes[i] = mixLane(lanes[i], words[i]);
+        }
+    }
+    length += size;
+}
+
+uint64_t SnapshotChecksum::finish() const {
+    uint64_t h = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18);
+    h ^= length * CHECKSUM_PRIME1;
+    h ^= h >> 33;
+    h *= CHECKSUM_PRIME2;
+    h ^= h >> 29;
+    return h;
+}
+
+static uint64_t metadataChecksum(const SnapshotHeader& header, const SnapshotBufferDesc* descs) {
+    SnapshotHeader copy = header;
+    copy.checksum = 0;
+    SnapshotChecksum sum;
+    sum.update(&copy, sizeof(copy));
+    sum.update(descs, header.buffer_count * sizeof(SnapshotBufferDesc));
+    return sum.finish();
+}
+
+static int writeAll(int fd, const void* data, size_t size, off_t offset) {
+    const char* p = (const char*)data;
+    while (size > 0) {
+        ssize_t n = pwrite(fd, p, size, offset);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        size -= n;
+        offset += n;
+    }
+    return 0;
+}
+
+// Two pinned staging buffers and a stream, released on scope exit
+struct PinnedPipeline {
+    void* host[2] = {nullptr, nullptr};
+    CUevent done[2] = {nullptr, nullptr};
+    CUstream stream = nullptr;
+
+    int init(size_t chunk_size) {
+        for (int i = 0; i < 2; ++i) {
+            if (cuMemHostAlloc(&host[i], chunk_size, 0) != CUDA_SUCCESS ||
+                cuEventCreate(&done[i], CU_EVENT_DISABLE_TIMING) != CUDA_SUCCESS) {
+                return -1;
+            }
+        }
+        return cuStreamCreate(&stream, CU_STREAM_NON_BLOCKING) == CUDA_SUCCESS ? 0 : -1;
+    }
+
+    ~PinnedPipeline() {
+        if (stream) {
+            cuStreamSynchronize(stream);
+            cuStreamDestroy(stream);
+        }
+        for (int i = 0; i < 2; ++i) {
+            if (done[i]) cuEventDestroy(done[i]);
+            if (host[i]) cuMemFreeHost(host[i]);
+        }
+    }
+};
+
+int writeSnapshot(const char* path, uint64_t generation, size_t alignment,
+                  const std::vector<SnapshotSource>& buffers, size_t chunk_size) {
+    uint64_t start_ns = monotonicNowNs();
+    chunk_size = (chunk_size + 31) & ~(size_t)31;
+
+    // 1. Lay out descriptors and aligned payload offsets
+    SnapshotHeader header = {};
+    header.magic = SNAPSHOT_MAGIC;
+    header.version = SNAPSHOT_VERSION;
+    header.buffer_count = buffers.size();
+    header.generation = generation;
+    header.alignment = alignment;
+
+    std::vector<SnapshotBufferDesc> descs(buffers.size());
+    size_t offset = alignSize(sizeof(header) + descs.size() * sizeof(SnapshotBufferDesc), alignment);
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        descs[i] = {buffers[i].id, buffers[i].size, buffers[i].aligned_size, offset, 0, 0,
+                    buffers[i].tensor};
+        offset = alignSize(offset + buffers[i].size, alignment);
+    }
+    header.file_size = offset;
+
+    std::string tmp_path = std::string(path) + ".tmp";
+    int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to create snapshot %s: %s\n", tmp_path.c_str(), strerror(errno));
+        return -1;
+    }
+    if (ftruncate(fd, header.file_size) < 0) {
+        fprintf(stderr, "Failed to size snapshot: %s\n", strerror(errno));
+        ::close(fd);
+        return -1;
+    }
+
+    // 2. Stream each buffer: the copy into one pinned buffer overlaps the
+    //    checksum and write of the other
+    PinnedPipeline pipe;
+    if (pipe.init(chunk_size) < 0) {
+        fprintf(stderr, "Failed to set up snapshot staging buffers\n");
+        ::close(fd);
+        return -1;
+    }
+
+    int status = 0;
+    for (size_t i = 0; i < buffers.size() && status == 0; ++i) {
+        const SnapshotSource& src = buffers[i];
+        size_t chunks = (src.size + chunk_size - 1) / chunk_size;
+        SnapshotChecksum sum;
+
+        auto issue = [&](size_t c) {
+            size_t pos = c * chunk_size;
+            size_t len = std::min(chunk_size, src.size - pos);
+            if (cuMemcpyDtoHAsync(pipe.host[c % 2], src.ptr + pos, len, pipe.stream) != CUDA_SUCCESS ||
+                cuEventRecord(pipe.done[c % 2], pipe.stream) != CUDA_SUCCESS) {
+                return -1;
+            }
+            return 0;
+        };
+
+        if (chunks > 0 && issue(0) < 0) status = -1;
+        for (size_t c = 0; c < chunks && status == 0; ++c) {
+            if (c + 1 < chunks && issue(c + 1) < 0) {
+                status = -1;
+                break;
+            }
+            if (cuEventSynchronize(pipe.done[c % 2]) != CUDA_SUCCESS) {
+                status = -1;
+                break;
+            }
+            size_t pos = c * chunk_size;
+            size_t len = std::min(chunk_size, src.size - pos);
+            sum.update(pipe.host[c % 2], len);
+            if (writeAll(fd, pipe.host[c % 2], len, descs[i].payload_offset + pos) < 0) {
+                fprintf(stderr, "Failed to write snapshot payload: %s\n", strerror(errno));
+                status = -1;
+            }
+        }
+        descs[i].checksum = sum.finish();
+    }
+
+    // 3. Metadata last, then make it durable and atomically visible
+    if (status == 0) {
+        header.checksum = metadataChecksum(header, descs.data());
+        if (writeAll(fd, &header, sizeof(header), 0) < 0 ||
+            writeAll(fd, descs.data(), descs.size() * sizeof(SnapshotBufferDesc), sizeof(header)) < 0 ||
+            fsync(fd) < 0) {
+            fprintf(stderr, "Failed to write snapshot header: %s\n", strerror(errno));
+            status = -1;
+        }
+    }
+    ::close(fd);
+    if (status == 0 && rename(tmp_path.c_str(), path) < 0) {
+        fprintf(stderr, "Failed to publish snapshot %s: %s\n", path, strerror(errno));
+        status = -1;
+    }
+    if (status < 0) {
+        unlink(tmp_path.c_str());
+        return -1;
+    }
+
+    double ms = (monotonicNowNs() - start_ns) / 1e6;
+    printf("Wrote snapshot %s: %zu buffers, %llu MB in %.2f ms\n", path, buffers.size(),
+           (unsigned long long)(header.file_size >> 20), ms);
+    return 0;
+}
+
+SnapshotReader::SnapshotReader() : fd_(-1), map_size_(0), header_(nullptr), descs_(nullptr) {
+}
+
+SnapshotReader::~SnapshotReader() {
+    close();
+}
+
+int SnapshotReader::open(const char* path) {
+    close();
+
+    fd_ = ::open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd_ < 0 || fstat(fd_, &st) != 0) {
+        fprintf(stderr, "Cannot open snapshot %s: %s\n", path, strerror(errno));
+        close();
+        return -1;
+    }
+    if ((size_t)st.st_size < sizeof(SnapshotHeader)) {
+        fprintf(stderr, "Snapshot %s is truncated\n", path);
+        close();
+        return -1;
+    }
+
+    void* addr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd_, 0);
+    if (addr == MAP_FAILED) {
+        fprintf(stderr, "Cannot map snapshot %s: %s\n", path, strerror(errno));
+        close();
+        return -1;
+    }
+    map_size_ = st.st_size;
+    header_ = (const SnapshotHeader*)addr;
+    descs_ = (const SnapshotBufferDesc*)(header_ + 1);
+    madvise(addr, map_size_, MADV_SEQUENTIAL);
+
+    // Validate everything upload() will trust
+    bool valid = header_->magic == SNAPSHOT_MAGIC && header_->version == SNAPSHOT_VERSION &&
+                 header_->file_size == map_size_ &&
+                 sizeof(SnapshotHeader) + header_->buffer_count * sizeof(SnapshotBufferDesc) <= map_size_;
+    if (valid && metadataChecksum(*header_, descs_) != header_->checksum) {
+        valid = false;
+    }
+    for (size_t i = 0; valid && i < header_->buffer_count; ++i) {
+        const SnapshotBufferDesc& desc = descs_[i];
+        valid = desc.size <= desc.aligned_size && desc.payload_offset <= map_size_ &&
+                desc.size <= map_size_ - desc.payload_offset;
+    }
+    if (!valid) {
+        fprintf(stderr, "Snapshot %s is corrupt or from another version\n", path);
+        close();
+        return -1;
+    }
+    return 0;
+}
+
+void SnapshotReader::close() {
+    if (header_) {
+        munmap((void*)header_, map_size_);
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+    fd_ = -1;
+    map_size_ = 0;
+    header_ = nullptr;
+    descs_ = nullptr;
+}
+
+int SnapshotReader::upload(size_t index, CUdeviceptr dst, size_t chunk_size) {
+    if (!header_ || index >= header_->buffer_count) {
+        return -1;
+    }
+    chunk_size = (chunk_size + 31) & ~(size_t)31;
+    const SnapshotBufferDesc& desc = descs_[index];
+    const char* payload = (const char*)header_ + desc.payload_offset;
+
+    PinnedPipeline pipe;
+    if (pipe.init(chunk_size) < 0) {
+        fprintf(stderr, "Failed to set up snapshot staging buffers\n");
+        return -1;
+    }
+
+    // Reading chunk c from the page cache (or disk) into pinned buffer c%2
+    // overlaps the DMA of chunk c-1 from the other buffer
+    SnapshotChecksum sum;
+    size_t chunks = (desc.size + chunk_size - 1) / chunk_size;
+    for (size_t c = 0; c < chunks; ++c) {
+        size_t pos = c * chunk_size;
+        size_t len = std::min<size_t>(chunk_size, desc.size - pos);
+        void* staging = pipe.host[c % 2];
+        if (c >= 2 && cuEventSynchronize(pipe.done[c % 2]) != CUDA_SUCCESS) {
+            return -1;
+        }
+        memcpy(staging, payload + pos, len);
+        sum.update(staging, len);
+        if (cuMemcpyHtoDAsync(dst + pos, staging, len, pipe.stream) != CUDA_SUCCESS ||
+            cuEventRecord(pipe.done[c % 2], pipe.stream) != CUDA_SUCCESS) {
+            return -1;
+        }
+    }
+    if (cuStreamSynchronize(pipe.stream) != CUDA_SUCCESS) {
+        return -1;
+    }
+
+    if (sum.finish() != desc.checksum) {
+        fprintf(stderr, "Snapshot buffer %llu failed its checksum\n", (unsigned long long)desc.id);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "tensor_desc.h"
+#include <cuda.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// On-disk snapshot of exported device buffers, so a restarted producer can
+// restore its data at disk bandwidth instead of recomputing it.
+//
+// Layout: SnapshotHeader, `buffer_count` SnapshotBufferDesc entries, then
+// each buffer's payload at an offset aligned to `alignment` (the VMM
+// granularity when written by the producer). Payload checksums cover the
+// logical size; the header checksum covers the header and descriptors.
+#define SNAPSHOT_MAGIC 0x3150414e534d4d56ULL  // "VMMSNAP1"
+#define SNAPSHOT_VERSION 2
+
+struct SnapshotHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t buffer_count;
+    uint64_t generation;
+    uint64_t alignment;
+    uint64_t file_size;
+    uint64_t checksum;          // Of header (with this field zero) + descriptors
+    uint64_t reserved[2];
+};
+
+struct SnapshotBufferDesc {
+    uint64_t id;
+    uint64_t size;              // Logical bytes
+    uint64_t aligned_size;      // Bytes to create and map on restore
+    uint64_t payload_offset;
+    uint64_t checksum;
+    uint64_t reserved;
+    TensorDescriptor tensor;    // As announced when the snapshot was written
+};
+
+// A mapped device buffer to write into a snapshot
+struct SnapshotSource {
+    uint64_t id;
+    CUdeviceptr ptr;
+    size_t size;
+    size_t aligned_size;
+    TensorDescriptor tensor;
+};
+
+constexpr size_t SNAPSHOT_DEFAULT_CHUNK = 8 * 1024 * 1024;
+
+// Fast 64-bit checksum (four interleaved multiply-rotate lanes); resumable
+// so chunks can be hashed as they stream through
+struct SnapshotChecksum {
+    uint64_t lanes[4];
+    uint64_t length;
+
+    SnapshotChecksum();
+    // Chunk sizes other than the last must be multiples of 32 bytes
+    void update(const void* data, size_t size);
+    uint64_t finish() const;
+};
+
+// Stream device -> host through pinned double buffers and write the file.
+// Writes to "<path>.tmp" and renames, so a crash never leaves a torn
+// snapshot behind. Returns 0 on success, -1 on error.
+int writeSnapshot(const char* path, uint64_t generation, size_t alignment,
+                  const std::vector<SnapshotSource>& buffers,
+                  size_t chunk_size = SNAPSHOT_DEFAULT_CHUNK);
+
+// Maps a snapshot file and uploads its buffers into freshly mapped VMM
+// memory in pipelined chunks
+class SnapshotReader {
+public:
+    SnapshotReader();
+    ~SnapshotReader();
+
+    // mmap and validate the header and descriptors
+    int open(const char* path);
+    void close();
+
+    uint64_t generation() const { return header_ ? header_->generation : 0; }
+    size_t bufferCount() const { return header_ ? header_->buffer_count : 0; }
+    const SnapshotBufferDesc& buffer(size_t index) const { return descs_[index]; }
+
+    // Upload buffer `index` to dst (mapped for at least its size). Disk
+    // reads into one pinned buffer overlap the async copy of the other.
+    // Returns -1 on a CUDA error or payload checksum mismatch.
+    int upload(size_t index, CUdeviceptr dst, size_t chunk_size = SNAPSHOT_DEFAULT_CHUNK);
+
+private:
+    SnapshotReader(const SnapshotReader&) = delete;
+    SnapshotReader& operator=(const SnapshotReader&) = delete;
+
+    int fd_;
+    size_t map_size_;
+    const SnapshotHeader* header_;
+    const SnapshotBufferDesc* descs_;
+};
@@ -0,0 +1,228 @@
+#include "tensor_desc.h"
+#include "cuda_ipc_common.h"
+#include <cstdio>
+#include <cstring>
+
+size_t tensorDTypeSize(TensorDType dtype) {
+    switch (dtype) {
+    case TensorDType::Int32:   return 4;
+    case TensorDType::Float32: return 4;
+    case TensorDType::Float16: return 2;
+    case TensorDType::Int8:    return 1;
+    case TensorDType::UInt8:   return 1;
+    }
+    return 0;
+}
+
+const char* tensorDTypeName(TensorDType dtype) {
+    switch (dtype) {
+    case TensorDType::Int32:   return "int32";
+    case TensorDType::Float32: return "float32";
+    case TensorDType::Float16: return "float16";
+    case TensorDType::Int8:    return "int8";
+    case TensorDType::UInt8:   return "uint8";
+    }
+    return "unknown";
+}
+
+int parseTensorDType(const char* name, TensorDType& dtype) {
+    static const TensorDType all[] = {TensorDType::Int32, TensorDType::Float32,
+                                      TensorDType::Float16, TensorDType::Int8,
+                                      TensorDType::UInt8};
+    for (TensorDType candidate : all) {
+        if (strcmp(name, tensorDTypeName(candidate)) == 0) {
+            dtype = candidate;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static DLDataType toDLDataType(TensorDType dtype) {
+    DLDataType dl = {};
+    dl.bits = (uint8_t)(tensorDTypeSize(dtype) * 8);
+    dl.lanes = 1;
+    switch (dtype) {
+    case TensorDType::Int32:
+    case TensorDType::Int8:
+        dl.code = kDLInt;
+        break;
+    case TensorDType::UInt8:
+        dl.code = kDLUInt;
+        break;
+    case TensorDType::Float32:
+    case TensorDType::Float16:
+        dl.code = kDLFloat;
+        break;
+    }
+    return dl;
+}
+
+TensorDescriptor makeTensorDescriptor(TensorDType dtype, std::initializer_list<int64_t> shape) {
+    TensorDescriptor desc = {};
+    desc.dtype = (uint8_t)dtype;
+    desc.ndim = (uint8_t)(shape.size() < TENSOR_MAX_DIMS ? shape.size() : TENSOR_MAX_DIMS);
+    const int64_t* dims = shape.begin();
+    int64_t stride = 1;
+    for (int d = desc.ndim - 1; d >= 0; --d) {
+        desc.shape[d] = dims[d];
+        desc.strides[d] = stride;
+        stride *= dims[d];
+    }
+    desc.logical_bytes = (uint64_t)stride * tensorDTypeSize(dtype);
+    return desc;
+}
+
+size_t tensorElementCount(const TensorDescriptor& desc) {
+    size_t count = 1;
+    for (uint32_t d = 0; d < desc.ndim; ++d) {
+        if (desc.shape[d] < 0 || __builtin_mul_overflow(count, (size_t)desc.shape[d], &count)) {
+            return 0;
+        }
+    }
+    return count;
+}
+
+bool tensorIsContiguous(const TensorDescriptor& desc) {
+    int64_t expected = 1;
+    for (int d = desc.ndim - 1; d >= 0; --d) {
+        if (desc.shape[d] != 1 && desc.strides[d] != expected) {
+            return false;
+        }
+        expected *= desc.shape[d];
+    }
+    return true;
+}
+
+bool tensorDescriptorsEqual(const TensorDescriptor& a, const TensorDescriptor& b) {
+    return memcmp(&a, &b, sizeof(TensorDescriptor)) == 0;
+}
+
+int validateTensorDescriptor(const TensorDescriptor& desc, size_t buffer_size) {
+    const size_t element_size = tensorDTypeSize((TensorDType)desc.dtype);
+    if (element_size == 0 || desc.ndim == 0 || desc.ndim > TENSOR_MAX_DIMS) {
+        fprintf(stderr, "Tensor descriptor: bad dtype %u or rank %u\n", desc.dtype, desc.ndim);
+        return -1;
+    }
+
+    // Highest element index reachable through shape/strides. No extent can
+    // exceed the buffer, and any product or sum that wraps is rejected, so
+    // huge dims cannot wrap the span (or the element count) to something small
+    const uint64_t max_extent = buffer_size / element_size;
+    uint64_t last = 0;
+    uint64_t count = 1;
+    for (uint32_t d = 0; d < desc.ndim; ++d) {
+        if (desc.shape[d] < 0 || desc.strides[d] < 0) {
+            fprintf(stderr, "Tensor descriptor: negative shape or stride in dim %u\n", d);
+            return -1;
+        }
+        const uint64_t extent = (uint64_t)desc.shape[d];
+        if (extent > max_extent) {
+            fprintf(stderr, "Tensor descriptor: dim %u extent %llu exceeds buffer of %zu bytes\n",
+                    d, (unsigned long long)extent, buffer_size);
+            return -1;
+        }
+        uint64_t term = 0;
+        if (__builtin_mul_overflow(count, extent, &count) ||
+            (extent > 0 && (__builtin_mul_overflow(extent - 1, (uint64_t)desc.strides[d], &term) ||
+                            __builtin_add_overflow(last, term, &last)))) {
+            fprintf(stderr, "Tensor descriptor: shape/strides overflow in dim %u\n", d);
+            return -1;
+        }
+    }
+    uint64_t span = 0;
+    if (count > 0 && (__builtin_add_overflow(last, 1, &span) ||
+                      __builtin_mul_overflow(span, (uint64_t)element_size, &span))) {
+        fprintf(stderr, "Tensor descriptor: span overflows\n");
+        return -1;
+    }
+    if (desc.byte_offset % element_size != 0 || desc.logical_bytes < span ||
+        desc.byte_offset > buffer_size || desc.logical_bytes > buffer_size - desc.byte_offset) {
+        fprintf(stderr, "Tensor descriptor: %llu bytes at offset %llu exceed buffer of %zu bytes\n",
+                (unsigned long long)desc.logical_bytes, (unsigned long long)desc.byte_offset,
+                buffer_size);
+        return -1;
+    }
+    return 0;
+}
+
+int generateTensorData(void* buffer, const TensorDescriptor& desc, uint32_t seed) {
+    if (!tensorIsContiguous(desc)) {
+        fprintf(stderr, "Tensor descriptor: test data needs a contiguous tensor\n");
+        return -1;
+    }
+    char* base = static_cast<char*>(buffer) + desc.byte_offset;
+    const size_t count = tensorElementCount(desc);
+    switch ((TensorDType)desc.dtype) {
+    case TensorDType::Int32:   generateTestData(reinterpret_cast<int*>(base), count, seed); return 0;
+    case TensorDType::Float32: generateTestData(reinterpret_cast<float*>(base), count, seed); return 0;
+    case TensorDType::Float16: generateTestData(reinterpret_cast<Float16*>(base), count, seed); return 0;
+    case TensorDType::Int8:    generateTestData(reinterpret_cast<int8_t*>(base), count, seed); return 0;
+    case TensorDType::UInt8:   generateTestData(reinterpret_cast<uint8_t*>(base), count, seed); return 0;
+    }
+    return -1;
+}
+
+bool verifyTensorData(const void* buffer, const TensorDescriptor& desc, uint32_t seed) {
+    if (!tensorIsContiguous(desc)) {
+        fprintf(stderr, "Tensor descriptor: test data needs a contiguous tensor\n");
+        return false;
+    }
+    const char* base = static_cast<const char*>(buffer) + desc.byte_offset;
+    const size_t count = tensorElementCount(desc);
+    switch ((TensorDType)desc.dtype) {
+    case TensorDType::Int32:   return verifyTestData(reinterpret_cast<const int*>(base), count, seed);
+    case TensorDType::Float32: return verifyTestData(reinterpret_cast<const float*>(base), count, seed);
+    case TensorDType::Float16: return verifyTestData(reinterpret_cast<const Float16*>(base), count, seed);
+    case TensorDType::Int8:    return verifyTestData(reinterpret_cast<const int8_t*>(base), count, seed);
+    case TensorDType::UInt8:   return verifyTestData(reinterpret_cast<const uint8_t*>(base), count, seed);
+    }
+    return false;
+}
+
+namespace {
+
+// Everything a DLManagedTensor points at lives in one allocation
+struct ManagedTensor {
+    DLManagedTensor managed;
+    int64_t shape[TENSOR_MAX_DIMS];
+    int64_t strides[TENSOR_MAX_DIMS];
+    void (*release)(void* ctx);
+    void* release_ctx;
+};
+
+void deleteManagedTensor(DLManagedTensor* self) {
+    ManagedTensor* owner = static_cast<ManagedTensor*>(self->manager_ctx);
+    if (owner->release) {
+        owner->release(owner->release_ctx);
+    }
+    delete owner;
+}
+
+}  // namespace
+
+DLManagedTensor* toDLPack(void* data, DLDevice device, const TensorDescriptor& desc,
+                          void (*release)(void* ctx), void* release_ctx) {
+    uint64_t buffer_size;
+    if (__builtin_add_overflow(desc.byte_offset, desc.logical_bytes, &buffer_size) ||
+        validateTensorDescriptor(desc, buffer_size) < 0) {
+        return nullptr;
+    }
+    ManagedTensor* owner = new ManagedTensor();
+    memcpy(owner->shape, desc.shape, sizeof(owner->shape));
+    memcpy(owner->strides, desc.strides, sizeof(owner->strides));
+    owner->release = release;
+    owner->release_ctx = release_ctx;
+
+    DLTensor& tensor = owner->managed.dl_tensor;
+    tensor.data = data;
+    tensor.device = device;
+    tensor.ndim = desc.ndim;
+    tensor.dtype = toDLDataType((TensorDType)desc.dtype);
+    tensor.shape = owner->shape;
+    tensor.strides = owner->strides;
+    tensor.byte_offset = desc.byte_offset;
+    owner->managed.manager_ctx = owner;
+    owner->managed.deleter = deleteManagedTensor;
+    return &owner->managed;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+
+#if __has_include(<dlpack/dlpack.h>)
+#include <dlpack/dlpack.h>
+#else
+// Layout-compatible subset of dlpack.h (v0.8), so frameworks' from_dlpack
+// can take these tensors when the real header is not installed
+extern "C" {
+typedef enum {
+    kDLCPU = 1,
+    kDLCUDA = 2,
+    kDLCUDAHost = 3,
+} DLDeviceType;
+
+typedef enum {
+    kDLInt = 0U,
+    kDLUInt = 1U,
+    kDLFloat = 2U,
+    kDLBfloat = 4U,
+} DLDataTypeCode;
+
+typedef struct {
+    DLDeviceType device_type;
+    int32_t device_id;
+} DLDevice;
+
+typedef struct {
+    uint8_t code;
+    uint8_t bits;
+    uint16_t lanes;
+} DLDataType;
+
+typedef struct {
+    void* data;
+    DLDevice device;
+    int32_t ndim;
+    DLDataType dtype;
+    int64_t* shape;
+    int64_t* strides;
+    uint64_t byte_offset;
+} DLTensor;
+
+typedef struct DLManagedTensor {
+    DLTensor dl_tensor;
+    void* manager_ctx;
+    void (*deleter)(struct DLManagedTensor* self);
+} DLManagedTensor;
+}
+#endif
+
+// Element types a shared buffer can be announced as
+enum class TensorDType : uint8_t {
+    Int32 = 0,
+    Float32 = 1,
+    Float16 = 2,
+    Int8 = 3,
+    UInt8 = 4,
+};
+
+constexpr uint32_t TENSOR_MAX_DIMS = 4;
+
+// Typed view of a shared buffer, sent by value in the buffer announcement.
+// Strides are in elements (DLPack convention), row-major when contiguous
+struct TensorDescriptor {
+    uint8_t dtype;                     // TensorDType
+    uint8_t ndim;
+    uint16_t reserved0;
+    uint32_t reserved1;
+    int64_t shape[TENSOR_MAX_DIMS];
+    int64_t strides[TENSOR_MAX_DIMS];
+    uint64_t byte_offset;              // Element 0 relative to the mapping
+    uint64_t logical_bytes;            // Bytes the tensor spans (<= buffer size)
+};
+
+size_t tensorDTypeSize(TensorDType dtype);
+const char* tensorDTypeName(TensorDType dtype);
+// Parses "int32", "float32", "float16", "int8", "uint8"; -1 if unknown
+int parseTensorDType(const char* name, TensorDType& dtype);
+
+// Contiguous row-major descriptor for `shape`
+TensorDescriptor makeTensorDescriptor(TensorDType dtype, std::initializer_list<int64_t> shape);
+// 0 if an extent is negative or the product overflows
+size_t tensorElementCount(const TensorDescriptor& desc);
+bool tensorIsContiguous(const TensorDescriptor& desc);
+bool tensorDescriptorsEqual(const TensorDescriptor& a, const TensorDescriptor& b);
+
+// Rejects unknown dtypes, bad ranks, negative extents, shape/stride
+// arithmetic that overflows and tensors that reach past buffer_size; -1
+// with a message on stderr
+int validateTensorDescriptor(const TensorDescriptor& desc, size_t buffer_size);
+
+// Fill / check a contiguous tensor's elements with the typed test pattern
+int generateTensorData(void* buffer, const TensorDescriptor& desc, uint32_t seed = 0);
+bool verifyTensorData(const void* buffer, const TensorDescriptor& desc, uint32_t seed = 0);
+
+// Wrap mapped memory as a DLPack tensor without copying. `data` is the
+// mapping base (byte_offset is carried separately). The returned tensor
+// owns only its shape/strides; calling its deleter invokes `release`
+// (if set), which is where the caller unmaps. nullptr if desc is invalid
+DLManagedTensor* toDLPack(void* data, DLDevice device, const TensorDescriptor& desc,
+                          void (*release)(void* ctx) = nullptr, void* release_ctx = nullptr);
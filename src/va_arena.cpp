@@ -0,0 +1,246 @@
+#include "va_arena.h"
+#include "cuda_ipc_common.h"
+#include <chrono>
+#include <cstring>
+
+static uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+double VAArenaStats::externalFragmentation() const {
+    return free_bytes ? 1.0 - (double)largest_free_block / free_bytes : 0.0;
+}
+
+double VAArenaStats::internalFragmentation() const {
+    return bytes_allocated ? 1.0 - (double)bytes_requested / bytes_allocated : 0.0;
+}
+
+BuddyAllocator::BuddyAllocator(size_t total_units) {
+    reset(total_units);
+}
+
+int BuddyAllocator::orderFor(size_t units) {
+    int order = 0;
+    while (((size_t)1 << order) < units) {
+        ++order;
+    }
+    return order;
+}
+
+void BuddyAllocator::reset(size_t total_units) {
+    total_units_ = total_units;
+    free_units_ = total_units;
+    allocated_.clear();
+
+    max_order_ = 0;
+    while (((size_t)2 << max_order_) <= total_units) {
+        ++max_order_;
+    }
+    free_lists_.assign(max_order_ + 1, std::set<size_t>());
+
+    // Non power-of-two sizes become a run of decreasing top-level blocks;
+    // each starts at a multiple of twice its size, so none has a false buddy
+    size_t offset = 0;
+    for (int order = max_order_; order >= 0 && total_units; --order) {
+        if (total_units & ((size_t)1 << order)) {
+            free_lists_[order].insert(offset);
+            offset += (size_t)1 << order;
+        }
+    }
+}
+
+size_t BuddyAllocator::allocate(size_t units) {
+    if (units == 0 || units > total_units_) {
+        return INVALID_OFFSET;
+    }
+
+    int order = orderFor(units);
+    int found = order;
+    while (found <= max_order_ && free_lists_[found].empty()) {
+        ++found;
+    }
+    if (found > max_order_) {
+        return INVALID_OFFSET;
+    }
+
+    // Lowest address first keeps live blocks packed toward the start
+    size_t offset = *free_lists_[found].begin();
+    free_lists_[found].erase(free_lists_[found].begin());
+
+    // Split down, returning upper halves to the free lists
+    while (found > order) {
+        --found;
+        free_lists_[found].insert(offset + ((size_t)1 << found));
+    }
+
+    allocated_[offset] = order;
+    free_units_ -= (size_t)1 << order;
+    return offset;
+}
+
+size_t BuddyAllocator::free(size_t offset) {
+    auto it = allocated_.find(offset);
+    if (it == allocated_.end()) {
+        return 0;
+    }
+    int order = it->second;
+    allocated_.erase(it);
+    size_t freed = (size_t)1 << order;
+    free_units_ += freed;
+
+    // Coalesce with free buddies as far up as possible
+    while (order < max_order_) {
+        size_t buddy = offset ^ ((size_t)1 << order);
+        auto buddy_it = free_lists_[order].find(buddy);
+        if (buddy_it == free_lists_[order].end()) {
+            break;
+        }
+        free_lists_[order].erase(buddy_it);
+        offset = offset < buddy ? offset : buddy;
+        ++order;
+    }
+    free_lists_[order].insert(offset);
+    return freed;
+}
+
+size_t BuddyAllocator::largestFreeBlock() const {
+    for (int order = max_order_; order >= 0; --order) {
+        if (!free_lists_[order].empty()) {
+            return (size_t)1 << order;
+        }
+    }
+    return 0;
+}
+
+VAArena::VAArena() : driver_(nullptr), base_(0), size_(0), granularity_(0) {
+    memset(&stats_, 0, sizeof(stats_));
+}
+
+VAArena::~VAArena() {
+    // May run from exit() after a CHECK_CUDA failure, so don't check again
+    if (base_ != 0) {
+        driver_->memAddressFree(base_, size_);
+    }
+}
+
+VAArena& VAArena::getInstance() {
+    static VAArena instance;
+    return instance;
+}
+
+size_t VAArena::configuredSize() {
+    const size_t default_size = 16ULL << 30;
+    const char* env = getenv("CUDA_VMM_VA_ARENA_SIZE");
+    if (!env || !*env) {
+        return default_size;
+    }
+
+    char* end = nullptr;
+    unsigned long long value = strtoull(env, &end, 10);
+    switch (*end) {
+        case 'G': case 'g': value <<= 30; break;
+        case 'M': case 'm': value <<= 20; break;
+        case 'K': case 'k': value <<= 10; break;
+        case '\0': break;
+        default:
+            fprintf(stderr, "Ignoring malformed CUDA_VMM_VA_ARENA_SIZE=%s\n", env);
+            return default_size;
+    }
+    return value;
+}
+
+int VAArena::init(size_t arena_size, size_t granularity, const VmmDriver& driver) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (base_ != 0) {
+        return 0;
+    }
+
+    size_ = (arena_size / granularity) * granularity;
+    if (size_ == 0) {
+        fprintf(stderr, "VA arena size %zu is smaller than granularity %zu\n",
+                arena_size, granularity);
+        return -1;
+    }
+
+    CHECK_CUDA(driver.memAddressReserve(&base_, size_, 0, 0, 0));
+    driver_ = &driver;
+    granularity_ = granularity;
+    buddy_.reset(size_ / granularity);
+    requested_.clear();
+    memset(&stats_, 0, sizeof(stats_));
+    stats_.capacity = size_;
+    printf("Reserved VA arena of %zu MB at 0x%llx\n", size_ >> 20, (unsigned long long)base_);
+    return 0;
+}
+
+void VAArena::destroy() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (base_ != 0) {
+        CHECK_CUDA(driver_->memAddressFree(base_, size_));
+        base_ = 0;
+        requested_.clear();
+    }
+}
+
+CUdeviceptr VAArena::allocate(size_t size) {
+    uint64_t start = nowNs();
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    size_t units = (size + granularity_ - 1) / granularity_;
+    size_t offset = base_ ? buddy_.allocate(units) : BuddyAllocator::INVALID_OFFSET;
+    if (offset == BuddyAllocator::INVALID_OFFSET) {
+        stats_.failed_allocations++;
+        return 0;
+    }
+
+    CUdeviceptr ptr = base_ + offset * granularity_;
+    requested_[ptr] = size;
+    stats_.allocations++;
+    stats_.alloc_ns += nowNs() - start;
+    return ptr;
+}
+
+void VAArena::free(CUdeviceptr ptr) {
+    uint64_t start = nowNs();
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = requested_.find(ptr);
+    if (it == requested_.end()) {
+        fprintf(stderr, "VA arena: free of unknown pointer 0x%llx\n", (unsigned long long)ptr);
+        return;
+    }
+    requested_.erase(it);
+    buddy_.free((ptr - base_) / granularity_);
+    stats_.frees++;
+    stats_.free_ns += nowNs() - start;
+}
+
+VAArenaStats VAArena::stats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    VAArenaStats result = stats_;
+    result.bytes_requested = 0;
+    for (const auto& entry : requested_) {
+        result.bytes_requested += entry.second;
+    }
+    result.live_allocations = requested_.size();
+    result.free_bytes = buddy_.freeUnits() * granularity_;
+    result.bytes_allocated = size_ - result.free_bytes;
+    result.largest_free_block = buddy_.largestFreeBlock() * granularity_;
+    return result;
+}
+
+void VAArena::printStats(const char* label) {
+    VAArenaStats s = stats();
+    printf("VA arena [%s]: %zu live, %zu/%zu MB allocated, largest free %zu MB\n",
+           label, s.live_allocations, s.bytes_allocated >> 20, s.capacity >> 20,
+           s.largest_free_block >> 20);
+    printf("  fragmentation: external %.1f%%, internal %.1f%%\n",
+           s.externalFragmentation() * 100, s.internalFragmentation() * 100);
+    printf("  %llu allocs (%.0f ns avg), %llu frees (%.0f ns avg), %llu failed\n",
+           (unsigned long long)s.allocations,
+           s.allocations ? (double)s.alloc_ns / s.allocations : 0.0,
+           (unsigned long long)s.frees,
+           s.frees ? (double)s.free_ns / s.frees : 0.0,
+           (unsigned long long)s.failed_allocations);
+}
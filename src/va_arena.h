@@ -0,0 +1,96 @@
+#pragma once
+
+#include "vmm_driver.h"
+#include <cuda.h>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+// Fragmentation and throughput counters for an arena
+struct VAArenaStats {
+    size_t capacity;           // Bytes reserved up front
+    size_t bytes_requested;    // Live bytes as requested by callers
+    size_t bytes_allocated;    // Live bytes including buddy rounding
+    size_t free_bytes;
+    size_t largest_free_block;
+    size_t live_allocations;
+    uint64_t allocations;
+    uint64_t frees;
+    uint64_t failed_allocations;
+    uint64_t alloc_ns;         // Total time spent in allocate()
+    uint64_t free_ns;          // Total time spent in free()
+
+    // 1 - largest_free_block / free_bytes (0 when free space is one block)
+    double externalFragmentation() const;
+    // Share of allocated bytes lost to power-of-two rounding
+    double internalFragmentation() const;
+};
+
+// Binary buddy allocator over granule offsets (host bookkeeping only)
+class BuddyAllocator {
+public:
+    explicit BuddyAllocator(size_t total_units = 0);
+
+    void reset(size_t total_units);
+
+    // Returns offset in units, or SIZE_MAX when no block is large enough
+    size_t allocate(size_t units);
+    // Returns the freed block size in units, or 0 for an unknown offset
+    size_t free(size_t offset);
+
+    size_t freeUnits() const { return free_units_; }
+    size_t largestFreeBlock() const;
+
+    static constexpr size_t INVALID_OFFSET = SIZE_MAX;
+
+private:
+    static int orderFor(size_t units);
+
+    size_t total_units_;
+    size_t free_units_;
+    int max_order_;
+    std::vector<std::set<size_t>> free_lists_;     // Per order, address ordered
+    std::unordered_map<size_t, int> allocated_;    // Offset -> order
+};
+
+// Per-process virtual address arena: one cuMemAddressReserve up front,
+// granularity-aligned sub-ranges handed out by a buddy allocator.
+// Reserving and freeing on the hot path is host bookkeeping only.
+class VAArena {
+public:
+    VAArena();
+    ~VAArena();
+
+    static VAArena& getInstance();
+
+    // Arena size from CUDA_VMM_VA_ARENA_SIZE (bytes, K/M/G suffix), default 16G
+    static size_t configuredSize();
+
+    int init(size_t arena_size, size_t granularity,
+             const VmmDriver& driver = realVmmDriver());
+    void destroy();
+    bool initialized() const { return base_ != 0; }
+
+    // Returns 0 when the arena is exhausted
+    CUdeviceptr allocate(size_t size);
+    void free(CUdeviceptr ptr);
+
+    VAArenaStats stats();
+    void printStats(const char* label);
+
+private:
+    VAArena(const VAArena&) = delete;
+    VAArena& operator=(const VAArena&) = delete;
+
+    std::mutex mutex_;
+    const VmmDriver* driver_;
+    CUdeviceptr base_;
+    size_t size_;
+    size_t granularity_;
+    BuddyAllocator buddy_;
+    std::unordered_map<CUdeviceptr, size_t> requested_;  // Ptr -> requested bytes
+    VAArenaStats stats_;
+};
@@ -0,0 +1,131 @@
+#include "versioned_mapping.h"
+#include "cuda_ipc_common.h"
+#include "va_arena.h"
+#include <mutex>
+#include <thread>
+
+VersionedMapping::VersionedMapping()
+    : device_(0), dptr_(0), size_(0), access_(CU_MEM_ACCESS_FLAGS_PROT_READ),
+      handle_(0), mapped_(false), generation_(0), swap_pending_(false) {}
+
+VersionedMapping::~VersionedMapping() {
+    release();
+}
+
+int VersionedMapping::reserve(CUdevice device, size_t size, CUmemAccess_flags access) {
+    if (dptr_ != 0) {
+        fprintf(stderr, "VersionedMapping already reserved\n");
+        return -1;
+    }
+
+    // The stable range comes from the per-process arena, like every other
+    // mapping, instead of a reservation of its own
+    VAArena& arena = VAArena::getInstance();
+    if (!arena.initialized() &&
+        arena.init(VAArena::configuredSize(), getMemoryGranularity(device)) < 0) {
+        return -1;
+    }
+    dptr_ = arena.allocate(size);
+    if (dptr_ == 0) {
+        fprintf(stderr, "VA arena exhausted\n");
+        return -1;
+    }
+    device_ = device;
+    size_ = size;
+    access_ = access;
+    return 0;
+}
+
+CUresult VersionedMapping::mapWithAccess(CUmemGenericAllocationHandle handle) {
+    CUresult result = cuMemMap(dptr_, size_, 0, handle, 0);
+    if (result != CUDA_SUCCESS) {
+        return result;
+    }
+
+    CUmemAccessDesc accessDesc = {};
+    accessDesc.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+    accessDesc.location.id = device_;
+    accessDesc.flags = access_;
+    result = cuMemSetAccess(dptr_, size_, &accessDesc, 1);
+    if (result != CUDA_SUCCESS) {
+        cuMemUnmap(dptr_, size_);
+    }
+    return result;
+}
+
+int VersionedMapping::swap(CUmemGenericAllocationHandle handle, size_t size, uint64_t generation) {
+    if (dptr_ == 0) {
+        fprintf(stderr, "VersionedMapping::swap called before reserve\n");
+        return -1;
+    }
+    if (size != size_) {
+        fprintf(stderr, "Rejected generation %llu of %zu bytes (mapping is %zu bytes)\n",
+                (unsigned long long)generation, size, size_);
+        return -1;
+    }
+    if (mapped_ && generation <= generation_.load(std::memory_order_relaxed)) {
+        fprintf(stderr, "Rejected stale generation %llu (current %llu)\n",
+                (unsigned long long)generation,
+                (unsigned long long)generation_.load(std::memory_order_relaxed));
+        return -1;
+    }
+
+    swap_pending_.store(true, std::memory_order_release);
+    std::unique_lock<std::shared_mutex> lock(swap_lock_);
+
+    // The range is briefly unmapped here; readers are excluded by the lock.
+    // The old handle is kept until the new one is mapped, so a failed map
+    // puts the previous generation back instead of leaving nothing mapped
+    if (mapped_) {
+        CHECK_CUDA(cuMemUnmap(dptr_, size_));
+    }
+    CUresult result = mapWithAccess(handle);
+    if (result != CUDA_SUCCESS) {
+        fprintf(stderr, "VersionedMapping: mapping generation %llu failed: %d\n",
+                (unsigned long long)generation, result);
+        if (mapped_ && mapWithAccess(handle_) != CUDA_SUCCESS) {
+            fprintf(stderr, "VersionedMapping: restoring the previous generation failed\n");
+            CHECK_CUDA(cuMemRelease(handle_));
+            mapped_ = false;
+        }
+        lock.unlock();
+        swap_pending_.store(false, std::memory_order_release);
+        return -1;
+    }
+    if (mapped_) {
+        CHECK_CUDA(cuMemRelease(handle_));
+    }
+
+    handle_ = handle;
+    mapped_ = true;
+    generation_.store(generation, std::memory_order_release);
+
+    lock.unlock();
+    swap_pending_.store(false, std::memory_order_release);
+    return 0;
+}
+
+void VersionedMapping::release() {
+    std::unique_lock<std::shared_mutex> lock(swap_lock_);
+    if (mapped_) {
+        CHECK_CUDA(cuMemUnmap(dptr_, size_));
+        CHECK_CUDA(cuMemRelease(handle_));
+        mapped_ = false;
+    }
+    if (dptr_ != 0) {
+        VAArena::getInstance().free(dptr_);
+        dptr_ = 0;
+    }
+}
+
+VersionedMapping::ReadGuard::ReadGuard(VersionedMapping& mapping) : mapping_(mapping) {
+    while (mapping_.swap_pending_.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+    mapping_.swap_lock_.lock_shared();
+    generation_ = mapping_.generation_.load(std::memory_order_acquire);
+}
+
+VersionedMapping::ReadGuard::~ReadGuard() {
+    mapping_.swap_lock_.unlock_shared();
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cuda.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <shared_mutex>
+
+// Consumer-side mapping whose virtual address stays fixed across producer
+// generations. Each generation arrives as a new physical handle; swap()
+// remaps the reserved VA range onto it with cuMemUnmap + cuMemMap.
+//
+// Readers hold a ReadGuard while touching ptr(). A swap waits for active
+// readers to drain and blocks new ones, so a reader always sees exactly one
+// generation and never a half-remapped range.
+class VersionedMapping {
+public:
+    VersionedMapping();
+    ~VersionedMapping();
+
+    // Take the stable VA range from VAArena::getInstance(), initializing the
+    // arena if needed (size must be granularity aligned)
+    int reserve(CUdevice device, size_t size,
+                CUmemAccess_flags access = CU_MEM_ACCESS_FLAGS_PROT_READ);
+
+    // Remap onto a new generation of `size` bytes (must equal the reserved
+    // size). On success takes ownership of handle and releases the previous
+    // generation's. Returns -1 on size/generation misuse or a failed map; the
+    // caller then still owns handle and the previous generation stays mapped.
+    int swap(CUmemGenericAllocationHandle handle, size_t size, uint64_t generation);
+
+    void release();
+
+    class ReadGuard {
+    public:
+        explicit ReadGuard(VersionedMapping& mapping);
+        ~ReadGuard();
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+
+        CUdeviceptr ptr() const { return mapping_.dptr_; }
+        uint64_t generation() const { return generation_; }
+
+    private:
+        VersionedMapping& mapping_;
+        uint64_t generation_;
+    };
+
+    ReadGuard read() { return ReadGuard(*this); }
+
+    CUdeviceptr ptr() const { return dptr_; }
+    size_t size() const { return size_; }
+    bool mapped() const { return mapped_; }
+
+    // Cheap check for readers that cache data derived from the mapping
+    uint64_t generation() const { return generation_.load(std::memory_order_acquire); }
+
+private:
+    CUresult mapWithAccess(CUmemGenericAllocationHandle handle);
+
+    CUdevice device_;
+    CUdeviceptr dptr_;
+    size_t size_;
+    CUmemAccess_flags access_;
+    CUmemGenericAllocationHandle handle_;
+    bool mapped_;
+
+    std::atomic<uint64_t> generation_;
+    std::atomic<bool> swap_pending_;  // Holds off new readers so swaps cannot starve
+    std::shared_mutex swap_lock_;
+};
@@ -0,0 +1,22 @@
+#include "vmm_driver.h"
+
+const VmmDriver& realVmmDriver() {
+    static const VmmDriver driver = {
+        "cuda",
+        cuCtxSetCurrent,
+        cuCtxSynchronize,
+        cuMemCreate,
+        cuMemRelease,
+        cuMemAddressReserve,
+        cuMemAddressFree,
+        cuMemMap,
+        cuMemUnmap,
+        cuMemSetAccess,
+        cuMemExportToShareableHandle,
+        cuMemImportFromShareableHandle,
+        cuMemcpyHtoD,
+        cuMemcpyDtoH,
+        cuMemcpyDtoD,
+    };
+    return driver;
+}
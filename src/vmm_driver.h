@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cuda.h>
+#include <cstddef>
+
+// Table of the driver entry points used by the VMM helpers. The real table
+// points at libcuda; vmm_emulation.h provides a host emulation with
+// injectable per-call latency, so the same code runs in benchmarks and
+// tests without a GPU.
+struct VmmDriver {
+    const char* name;
+    CUresult (*ctxSetCurrent)(CUcontext);
+    CUresult (*ctxSynchronize)();
+    CUresult (*memCreate)(CUmemGenericAllocationHandle*, size_t, const CUmemAllocationProp*, unsigned long long);
+    CUresult (*memRelease)(CUmemGenericAllocationHandle);
+    CUresult (*memAddressReserve)(CUdeviceptr*, size_t, size_t, CUdeviceptr, unsigned long long);
+    CUresult (*memAddressFree)(CUdeviceptr, size_t);
+    CUresult (*memMap)(CUdeviceptr, size_t, size_t, CUmemGenericAllocationHandle, unsigned long long);
+    CUresult (*memUnmap)(CUdeviceptr, size_t);
+    CUresult (*memSetAccess)(CUdeviceptr, size_t, const CUmemAccessDesc*, size_t);
+    CUresult (*memExportToShareableHandle)(void*, CUmemGenericAllocationHandle, CUmemAllocationHandleType, unsigned long long);
+    CUresult (*memImportFromShareableHandle)(CUmemGenericAllocationHandle*, void*, CUmemAllocationHandleType);
+    CUresult (*memcpyHtoD)(CUdeviceptr, const void*, size_t);
+    CUresult (*memcpyDtoH)(void*, CUdeviceptr, size_t);
+    CUresult (*memcpyDtoD)(CUdeviceptr, CUdeviceptr, size_t);
+};
+
+// Driver table backed by libcuda
+const VmmDriver& realVmmDriver();
@@ -0,0 +1,211 @@
+#include "vmm_emulation.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+
+struct EmulatedHandle {
+    int memfd;
+    size_t size;
+};
+
+std::mutex g_mutex;
+std::unordered_map<CUmemGenericAllocationHandle, EmulatedHandle> g_handles;
+std::atomic<CUmemGenericAllocationHandle> g_next_handle(1);
+VmmEmulationConfig g_config = defaultVmmEmulationConfig();
+
+void injectLatency(VmmEmulatedCall call) {
+    uint64_t ns = g_config.latency_ns[call];
+    if (ns == 0) return;
+    struct timespec ts;
+    ts.tv_sec = ns / 1000000000ULL;
+    ts.tv_nsec = ns % 1000000000ULL;
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+bool lookupHandle(CUmemGenericAllocationHandle handle, EmulatedHandle& out) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    auto it = g_handles.find(handle);
+    if (it == g_handles.end()) return false;
+    out = it->second;
+    return true;
+}
+
+CUmemGenericAllocationHandle addHandle(int memfd, size_t size) {
+    CUmemGenericAllocationHandle handle = g_next_handle.fetch_add(1);
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_handles[handle] = {memfd, size};
+    return handle;
+}
+
+CUresult emuCtxSetCurrent(CUcontext) {
+    return CUDA_SUCCESS;
+}
+
+// Emulated copies complete before returning
+CUresult emuCtxSynchronize() {
+    return CUDA_SUCCESS;
+}
+
+CUresult emuMemCreate(CUmemGenericAllocationHandle* handle, size_t size,
+                      const CUmemAllocationProp*, unsigned long long) {
+    injectLatency(VMM_EMU_CREATE);
+    if (size == 0 || size % g_config.granularity != 0) return CUDA_ERROR_INVALID_VALUE;
+
+    int memfd = memfd_create("vmm_emulated_handle", MFD_CLOEXEC);
+    if (memfd < 0) return CUDA_ERROR_OUT_OF_MEMORY;
+    if (ftruncate(memfd, size) < 0) {
+        close(memfd);
+        return CUDA_ERROR_OUT_OF_MEMORY;
+    }
+    *handle = addHandle(memfd, size);
+    return CUDA_SUCCESS;
+}
+
+CUresult emuMemRelease(CUmemGenericAllocationHandle handle) {
+    injectLatency(VMM_EMU_RELEASE);
+    std::lock_guard<std::mutex> lock(g_mutex);
+    auto it = g_handles.find(handle);
+    if (it == g_handles.end()) return CUDA_ERROR_INVALID_VALUE;
+    // Existing mappings keep the pages alive, as with the real driver
+    close(it->second.memfd);
+    g_handles.erase(it);
+    return CUDA_SUCCESS;
+}
+
+CUresult emuMemAddressReserve(CUdeviceptr* ptr, size_t size, size_t,
+                              CUdeviceptr, unsigned long long) {
+    injectLatency(VMM_EMU_ADDRESS_RESERVE);
+    void* addr = mmap(NULL, size, PROT_NONE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (addr == MAP_FAILED) return CUDA_ERROR_OUT_OF_MEMORY;
+    *ptr = (CUdeviceptr)addr;
+    return CUDA_SUCCESS;
+}
+
+CUresult emuMemAddressFree(CUdeviceptr ptr, size_t size) {
+    injectLatency(VMM_EMU_ADDRESS_FREE);
+    return munmap((void*)ptr, size) == 0 ? CUDA_SUCCESS : CUDA_ERROR_INVALID_VALUE;
+}
+
+CUresult emuMemMap(CUdeviceptr ptr, size_t size, size_t offset,
+                   CUmemGenericAllocationHandle handle, unsigned long long) {
+    injectLatency(VMM_EMU_MAP);
+    EmulatedHandle emulated;
+    if (!lookupHandle(handle, emulated)) return CUDA_ERROR_INVALID_HANDLE;
+    if (offset % g_config.granularity != 0 || offset + size > emulated.size) {
+        return CUDA_ERROR_INVALID_VALUE;
+    }
+    // Inaccessible until cuMemSetAccess, like a fresh driver mapping
+    void* addr = mmap((void*)ptr, size, PROT_NONE, MAP_SHARED | MAP_FIXED,
+                      emulated.memfd, offset);
+    return addr == MAP_FAILED ? CUDA_ERROR_INVALID_VALUE : CUDA_SUCCESS;
+}
+
+CUresult emuMemUnmap(CUdeviceptr ptr, size_t size) {
+    injectLatency(VMM_EMU_UNMAP);
+    // Put the reservation back in place of the mapping
+    void* addr = mmap((void*)ptr, size, PROT_NONE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+    return addr == MAP_FAILED ? CUDA_ERROR_INVALID_VALUE : CUDA_SUCCESS;
+}
+
+CUresult emuMemSetAccess(CUdeviceptr ptr, size_t size, const CUmemAccessDesc* desc, size_t count) {
+    injectLatency(VMM_EMU_SET_ACCESS);
+    if (count == 0) return CUDA_ERROR_INVALID_VALUE;
+    int prot = PROT_NONE;
+    if (desc[0].flags == CU_MEM_ACCESS_FLAGS_PROT_READ) {
+        prot = PROT_READ;
+    } else if (desc[0].flags == CU_MEM_ACCESS_FLAGS_PROT_READWRITE) {
+        prot = PROT_READ | PROT_WRITE;
+    }
+    return mprotect((void*)ptr, size, prot) == 0 ? CUDA_SUCCESS : CUDA_ERROR_INVALID_VALUE;
+}
+
+CUresult emuMemExportToShareableHandle(void* shareable, CUmemGenericAllocationHandle handle,
+                                       CUmemAllocationHandleType type, unsigned long long) {
+    injectLatency(VMM_EMU_EXPORT);
+    if (type != CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR) return CUDA_ERROR_NOT_SUPPORTED;
+    EmulatedHandle emulated;
+    if (!lookupHandle(handle, emulated)) return CUDA_ERROR_INVALID_HANDLE;
+    int fd = dup(emulated.memfd);
+    if (fd < 0) return CUDA_ERROR_OUT_OF_MEMORY;
+    *(int*)shareable = fd;
+    return CUDA_SUCCESS;
+}
+
+CUresult emuMemImportFromShareableHandle(CUmemGenericAllocationHandle* handle, void* os_handle,
+                                         CUmemAllocationHandleType type) {
+    injectLatency(VMM_EMU_IMPORT);
+    if (type != CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR) return CUDA_ERROR_NOT_SUPPORTED;
+    int fd = (int)(intptr_t)os_handle;
+    struct stat st;
+    if (fstat(fd, &st) != 0) return CUDA_ERROR_INVALID_VALUE;
+    int memfd = dup(fd);
+    if (memfd < 0) return CUDA_ERROR_OUT_OF_MEMORY;
+    *handle = addHandle(memfd, st.st_size);
+    return CUDA_SUCCESS;
+}
+
+CUresult emuMemcpyHtoD(CUdeviceptr dst, const void* src, size_t size) {
+    injectLatency(VMM_EMU_MEMCPY);
+    memcpy((void*)dst, src, size);
+    return CUDA_SUCCESS;
+}
+
+CUresult emuMemcpyDtoH(void* dst, CUdeviceptr src, size_t size) {
+    injectLatency(VMM_EMU_MEMCPY);
+    memcpy(dst, (const void*)src, size);
+    return CUDA_SUCCESS;
+}
+
+CUresult emuMemcpyDtoD(CUdeviceptr dst, CUdeviceptr src, size_t size) {
+    injectLatency(VMM_EMU_MEMCPY);
+    memmove((void*)dst, (const void*)src, size);
+    return CUDA_SUCCESS;
+}
+
+} // namespace
+
+VmmEmulationConfig defaultVmmEmulationConfig() {
+    VmmEmulationConfig config = {};
+    config.granularity = 2 * 1024 * 1024;
+    return config;
+}
+
+void configureVmmEmulation(const VmmEmulationConfig& config) {
+    g_config = config;
+}
+
+const VmmEmulationConfig& vmmEmulationConfig() {
+    return g_config;
+}
+
+const VmmDriver& emulatedVmmDriver() {
+    static const VmmDriver driver = {
+        "emulated",
+        emuCtxSetCurrent,
+        emuCtxSynchronize,
+        emuMemCreate,
+        emuMemRelease,
+        emuMemAddressReserve,
+        emuMemAddressFree,
+        emuMemMap,
+        emuMemUnmap,
+        emuMemSetAccess,
+        emuMemExportToShareableHandle,
+        emuMemImportFromShareableHandle,
+        emuMemcpyHtoD,
+        emuMemcpyDtoH,
+        emuMemcpyDtoD,
+    };
+    return driver;
+}
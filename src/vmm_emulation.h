@@ -0,0 +1,38 @@
+#pragma once
+
+#include "vmm_driver.h"
+#include <cstdint>
+
+// Host emulation of the CUDA VMM API. Physical handles are memfds, VA
+// reservations are PROT_NONE host mappings, cuMemMap maps the memfd at the
+// reserved address and cuMemSetAccess is mprotect, so "device pointers"
+// are real host pointers and copies are memcpy. Exported FDs are memfds
+// and can be passed between processes like real VMM handles.
+//
+// Each call sleeps for its configured latency (outside any lock) to model
+// driver cost, so concurrency effects show up as they would on hardware.
+enum VmmEmulatedCall {
+    VMM_EMU_CREATE,
+    VMM_EMU_RELEASE,
+    VMM_EMU_ADDRESS_RESERVE,
+    VMM_EMU_ADDRESS_FREE,
+    VMM_EMU_MAP,
+    VMM_EMU_UNMAP,
+    VMM_EMU_SET_ACCESS,
+    VMM_EMU_EXPORT,
+    VMM_EMU_IMPORT,
+    VMM_EMU_MEMCPY,
+    VMM_EMU_CALL_COUNT
+};
+
+struct VmmEmulationConfig {
+    size_t granularity;                           // Reported granularity (default 2 MB)
+    uint64_t latency_ns[VMM_EMU_CALL_COUNT];      // Injected latency per call
+};
+
+VmmEmulationConfig defaultVmmEmulationConfig();
+void configureVmmEmulation(const VmmEmulationConfig& config);
+const VmmEmulationConfig& vmmEmulationConfig();
+
+// Driver table backed by the emulation
+const VmmDriver& emulatedVmmDriver();
@@ -0,0 +1,111 @@
+// Live view of the GPU memory budget kept by libcuda_ro_wrapper.so
+#include "cuda_ro_budget.h"
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static uint64_t load(const uint64_t& counter) {
+    return __atomic_load_n(&counter, __ATOMIC_RELAXED);
+}
+
+static const char* formatBytes(uint64_t bytes, char* buf, size_t len) {
+    if (bytes == 0) {
+        snprintf(buf, len, "-");
+    } else if (bytes >= (1ULL << 30)) {
+        snprintf(buf, len, "%.2f GB", bytes / (double)(1ULL << 30));
+    } else {
+        snprintf(buf, len, "%.2f MB", bytes / (double)(1ULL << 20));
+    }
+    return buf;
+}
+
+static void printUsage(const CuRoBudgetMap* map) {
+    char a[32], b[32], c[32], d[32], e[32], f[32];
+
+    printf("%-8s %-6s %12s %12s %12s %12s %8s %12s %12s %7s\n",
+           "PID", "STATE", "PRIVATE", "EXPORTED", "TOTAL", "PEAK",
+           "ALLOCS", "SOFT", "HARD", "DENIED");
+
+    uint64_t private_total = 0, exported_total = 0;
+    for (int i = 0; i < CU_RO_BUDGET_MAX_PROCESSES; i++) {
+        const CuRoBudgetProcess& slot = map->processes[i];
+        int32_t pid = __atomic_load_n(&slot.pid, __ATOMIC_ACQUIRE);
+        if (pid <= 0) continue;
+
+        // Dead slots are reclaimed by the next process that starts CUDA
+        bool alive = kill(pid, 0) == 0 || errno != ESRCH;
+        uint64_t private_bytes = load(slot.private_bytes);
+        uint64_t exported_bytes = load(slot.exported_bytes);
+        private_total += private_bytes;
+        exported_total += exported_bytes;
+        printf("%-8d %-6s %12s %12s %12s %12s %8llu %12s %12s %7llu\n",
+               pid, alive ? "alive" : "dead",
+               formatBytes(private_bytes, a, sizeof(a)),
+               formatBytes(exported_bytes, b, sizeof(b)),
+               formatBytes(private_bytes + exported_bytes, c, sizeof(c)),
+               formatBytes(load(slot.peak_bytes), d, sizeof(d)),
+               (unsigned long long)load(slot.allocations),
+               formatBytes(slot.soft_limit, e, sizeof(e)),
+               formatBytes(slot.hard_limit, f, sizeof(f)),
+               (unsigned long long)load(slot.denied));
+    }
+
+    printf("Node: %s in use (%s private, %s exported), peak %s\n",
+           formatBytes(load(map->node_bytes), a, sizeof(a)),
+           formatBytes(private_total, b, sizeof(b)),
+           formatBytes(exported_total, c, sizeof(c)),
+           formatBytes(load(map->node_peak_bytes), d, sizeof(d)));
+    printf("Node limits: soft %s, hard %s; %llu denied, %llu dead processes reclaimed\n",
+           formatBytes(load(map->node_soft_limit), a, sizeof(a)),
+           formatBytes(load(map->node_hard_limit), b, sizeof(b)),
+           (unsigned long long)load(map->node_denied),
+           (unsigned long long)load(map->reclaimed_processes));
+}
+
+int main(int argc, char** argv) {
+    int interval_ms = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--watch") == 0) {
+            interval_ms = (i + 1 < argc) ? atoi(argv[++i]) : 1000;
+        } else {
+            fprintf(stderr, "Usage: %s [--watch <ms>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    int fd = shm_open(CU_RO_BUDGET_SHM_NAME, O_RDONLY, 0);
+    if (fd < 0) {
+        fprintf(stderr, "No budget accounting on this node (%s: %s)\n",
+                CU_RO_BUDGET_SHM_NAME, strerror(errno));
+        return 1;
+    }
+    void* addr = mmap(NULL, sizeof(CuRoBudgetMap), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        fprintf(stderr, "Failed to map %s: %s\n", CU_RO_BUDGET_SHM_NAME, strerror(errno));
+        return 1;
+    }
+
+    const CuRoBudgetMap* map = (const CuRoBudgetMap*)addr;
+    if (__atomic_load_n(&map->init_state, __ATOMIC_ACQUIRE) != BUDGET_READY ||
+        map->magic != CU_RO_BUDGET_MAGIC || map->version != CU_RO_BUDGET_VERSION) {
+        fprintf(stderr, "%s is not a version %d budget table\n",
+                CU_RO_BUDGET_SHM_NAME, CU_RO_BUDGET_VERSION);
+        return 1;
+    }
+
+    do {
+        if (interval_ms) printf("\033[H\033[J");
+        printUsage(map);
+        fflush(stdout);
+        if (interval_ms) usleep(interval_ms * 1000);
+    } while (interval_ms);
+
+    munmap(addr, sizeof(CuRoBudgetMap));
+    return 0;
+}
@@ -0,0 +1,96 @@
+// Merge per-process handoff traces (CUDA_VMM_HANDOFF_TRACE) into one Chrome
+// trace and print where the time went: each phase per process, and how long
+// each message took from the sender's timestamp to receipt
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+// Value of "key": in one of our single-line events ("" if absent)
+static std::string field(const std::string& line, const char* key) {
+    std::string pattern = std::string("\"") + key + "\":";
+    size_t pos = line.find(pattern);
+    if (pos == std::string::npos) return "";
+    pos += pattern.size();
+    if (line[pos] == '"') {
+        size_t end = line.find('"', pos + 1);
+        return line.substr(pos + 1, end - pos - 1);
+    }
+    size_t end = line.find_first_of(",}", pos);
+    return line.substr(pos, end - pos);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s OUTPUT.json TRACE.json...\n", argv[0]);
+        return 1;
+    }
+
+    // 1. Collect event lines from every input
+    std::vector<std::string> events;
+    for (int i = 2; i < argc; ++i) {
+        std::ifstream in(argv[i]);
+        if (!in) {
+            fprintf(stderr, "Failed to open %s\n", argv[i]);
+            return 1;
+        }
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.compare(0, 9, "{\"name\":\"") != 0) continue;
+            if (!line.empty() && line.back() == ',') line.pop_back();
+            events.push_back(line);
+        }
+    }
+
+    // 2. Write the merged trace
+    FILE* out = fopen(argv[1], "w");
+    if (!out) {
+        fprintf(stderr, "Failed to create %s\n", argv[1]);
+        return 1;
+    }
+    fprintf(out, "{\"traceEvents\":[\n");
+    for (size_t i = 0; i < events.size(); ++i) {
+        fprintf(out, "%s%s\n", events[i].c_str(), i + 1 < events.size() ? "," : "");
+    }
+    fprintf(out, "],\"displayTimeUnit\":\"ns\"}\n");
+    fclose(out);
+    printf("Merged %zu events from %d traces into %s\n", events.size(), argc - 2, argv[1]);
+
+    // 3. Phases per process, in timeline order
+    std::map<std::string, std::string> process_names;
+    for (const std::string& e : events) {
+        if (field(e, "ph") == "M") {
+            process_names[field(e, "pid")] = field(e, "name") == "process_name"
+                ? field(e.substr(e.find("\"args\"")), "name") : "";
+        }
+    }
+    std::multimap<double, const std::string*> spans;
+    for (const std::string& e : events) {
+        if (field(e, "ph") == "X") spans.emplace(atof(field(e, "ts").c_str()), &e);
+    }
+    const double origin = spans.empty() ? 0 : spans.begin()->first;
+    printf("%10s %-10s %-30s %10s\n", "start ms", "process", "phase", "ms");
+    for (const auto& span : spans) {
+        const std::string& e = *span.second;
+        printf("%10.3f %-10s %-30s %10.3f\n", (span.first - origin) / 1e3,
+               process_names[field(e, "pid")].c_str(), field(e, "name").c_str(),
+               atof(field(e, "dur").c_str()) / 1e3);
+    }
+
+    // 4. Message transit: flow start (sender timestamp) to flow end (receipt)
+    std::map<std::string, double> sent;
+    for (const std::string& e : events) {
+        if (field(e, "ph") == "s") sent[field(e, "id")] = atof(field(e, "ts").c_str());
+    }
+    for (const std::string& e : events) {
+        if (field(e, "ph") != "f") continue;
+        auto it = sent.find(field(e, "id"));
+        if (it == sent.end()) continue;
+        printf("Message %-20s in flight %8.1f us\n", field(e, "name").c_str(),
+               atof(field(e, "ts").c_str()) - it->second);
+    }
+    return 0;
+}
@@ -0,0 +1,471 @@
+// Multi-process contention harness for the wrapper's SharedHandleMap.
+// Forked workers share one session registry (inherited like a forked worker
+// pool), mark their own memfds read-only and look up memfds passed to them
+// by a neighbour over SCM_RIGHTS. No GPU needed: links only the wrapper's
+// registry code
+#include "cuda_ro_internal.h"
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <signal.h>
+#include <sched.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <algorithm>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+constexpr int MAX_WORKERS = 256;
+constexpr int HIST_BUCKETS = 256;
+
+struct StressConfig {
+    std::vector<int> worker_counts;
+    uint64_t ops;            // Timed operations per worker
+    uint64_t rate;           // Per-worker ops/s, 0 = unthrottled
+    int write_percent;       // Share of ops that re-mark (take the registry lock)
+    int fds_per_worker;
+    bool kill_holder;
+    int timeout_ms;
+};
+
+struct WorkerResult {
+    std::atomic<int> done;
+    uint64_t ops;
+    uint64_t writes;
+    uint64_t missed_lookups;  // Peer's read-only memfd not found
+    uint64_t errors;
+    uint64_t elapsed_ns;
+    uint64_t hist[HIST_BUCKETS];
+};
+
+// Anonymous shared memory created per trial, before forking
+struct SharedTrial {
+    std::atomic<int> ready;
+    std::atomic<int> go;
+    struct Identity {
+        dev_t dev;
+        ino_t ino;
+    } identities[MAX_SHARED_HANDLES];
+    WorkerResult workers[MAX_WORKERS];
+};
+
+static uint64_t nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Log-linear latency histogram: 4 buckets per power of two
+static int bucketOf(uint64_t ns) {
+    if (ns < 4) return (int)ns;
+    int msb = 63 - __builtin_clzll(ns);
+    return 4 + (msb - 2) * 4 + (int)((ns >> (msb - 2)) & 3);
+}
+
+static uint64_t bucketFloor(int bucket) {
+    if (bucket < 4) return bucket;
+    int msb = (bucket - 4) / 4 + 2;
+    return (uint64_t)(4 + (bucket - 4) % 4) << (msb - 2);
+}
+
+static double percentileUs(const uint64_t* hist, uint64_t total, double p) {
+    if (total == 0) return 0;
+    uint64_t target = std::min((uint64_t)(p * total), total - 1);
+    uint64_t seen = 0;
+    for (int b = 0; b < HIST_BUCKETS; ++b) {
+        seen += hist[b];
+        if (seen > target) {
+            return bucketFloor(b + 1) / 1000.0;
+        }
+    }
+    return 0;
+}
+
+static int sendFd(int sock, int fd) {
+    char byte = 0;
+    struct iovec iov = {&byte, 1};
+    char buf[CMSG_SPACE(sizeof(int))] = {};
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = buf;
+    msg.msg_controllen = sizeof(buf);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    return sendmsg(sock, &msg, 0) == 1 ? 0 : -1;
+}
+
+static int recvFd(int sock) {
+    char byte;
+    struct iovec iov = {&byte, 1};
+    char buf[CMSG_SPACE(sizeof(int))] = {};
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = buf;
+    msg.msg_controllen = sizeof(buf);
+    if (recvmsg(sock, &msg, 0) != 1) return -1;
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (!cmsg || cmsg->cmsg_type != SCM_RIGHTS) return -1;
+    int fd;
+    memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+    return fd;
+}
+
+static void runWorker(int index, int fds_per_worker, const StressConfig& config,
+                      SharedTrial* trial, int send_sock, int recv_sock) {
+    WrapperState& state = WrapperState::getInstance();
+    WorkerResult& result = trial->workers[index];
+
+    // 1. Mark this worker's memfds read-only and record their identities
+    std::vector<int> own, peer;
+    for (int j = 0; j < fds_per_worker; ++j) {
+        int fd = memfd_create("registry_stress", MFD_CLOEXEC);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            result.errors++;
+            continue;
+        }
+        trial->identities[index * fds_per_worker + j] = {st.st_dev, st.st_ino};
+        state.markFdAsReadOnly(fd);
+        own.push_back(fd);
+    }
+
+    // 2. Hand them to the next worker; look up the previous worker's
+    for (int fd : own) {
+        if (sendFd(send_sock, fd) < 0) result.errors++;
+    }
+    for (size_t j = 0; j < own.size(); ++j) {
+        int fd = recvFd(recv_sock);
+        if (fd < 0) {
+            result.errors++;
+            continue;
+        }
+        peer.push_back(fd);
+    }
+    if (own.empty() || peer.empty()) {
+        result.done.store(1, std::memory_order_release);
+        _exit(1);
+    }
+
+    // 3. Start together, then run the read/write mix
+    trial->ready.fetch_add(1);
+    while (!trial->go.load(std::memory_order_acquire)) {
+        sched_yield();
+    }
+    uint64_t rng = 0x9E3779B97F4A7C15ULL * (index + 1);
+    const uint64_t period_ns = config.rate ? 1000000000ULL / config.rate : 0;
+    const uint64_t start = nowNs();
+    uint64_t next = start;
+    for (uint64_t i = 0; i < config.ops; ++i) {
+        if (period_ns) {
+            next += period_ns;
+            struct timespec ts = {(time_t)(next / 1000000000ULL), (long)(next % 1000000000ULL)};
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+        }
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        const bool write = (int)(rng % 100) < config.write_percent;
+
+        uint64_t t0 = nowNs();
+        if (write) {
+            state.markFdAsReadOnly(own[(rng >> 8) % own.size()]);
+            result.writes++;
+        } else if (!state.isFdReadOnly(peer[(rng >> 8) % peer.size()])) {
+            result.missed_lookups++;
+        }
+        result.hist[bucketOf(nowNs() - t0)]++;
+    }
+    result.elapsed_ns = nowNs() - start;
+    result.ops = config.ops;
+    result.done.store(1, std::memory_order_release);
+    _exit(0);
+}
+
+// Writable mapping of the session registry (the memfd inherited from the
+// trial process); used to act as a lock holder
+static SharedHandleMap* mapRegistryWritable() {
+    DIR* dir = opendir("/proc/self/fd");
+    if (!dir) return nullptr;
+    SharedHandleMap* map = nullptr;
+    while (struct dirent* entry = readdir(dir)) {
+        char link[256], target[256];
+        snprintf(link, sizeof(link), "/proc/self/fd/%.32s", entry->d_name);
+        ssize_t len = readlink(link, target, sizeof(target) - 1);
+        if (len <= 0) continue;
+        target[len] = '\0';
+        if (!strstr(target, "cuda_ro_wrapper_registry")) continue;
+        void* addr = mmap(NULL, sizeof(SharedHandleMap), PROT_READ | PROT_WRITE, MAP_SHARED,
+                          atoi(entry->d_name), 0);
+        if (addr != MAP_FAILED) {
+            map = (SharedHandleMap*)addr;
+            break;
+        }
+    }
+    closedir(dir);
+    return map;
+}
+
+// Fork a process that is SIGKILLed holding the registry lock, halfway
+// through rewriting probe_fd's ranges and through adding a new entry
+static int killLockHolder(int probe_fd) {
+    int pipe_fds[2];
+    if (pipe(pipe_fds) < 0) return -1;
+    pid_t pid = fork();
+    if (pid == 0) {
+        WrapperState::getInstance().markFdRanges(probe_fd, {{0, 4096}}, 4096);
+        SharedHandleMap* map = mapRegistryWritable();
+        if (!map) _exit(1);
+        pthread_mutex_lock(&map->lock);
+        map->entries[0].range_writer_pid = getpid();
+        map->entries[0].range_seq.fetch_add(1);
+        map->entries[map->handle_count.load()].state.store(ENTRY_WRITING);
+        char byte = 'L';
+        if (write(pipe_fds[1], &byte, 1) != 1) _exit(1);
+        pause();
+        _exit(0);
+    }
+    close(pipe_fds[1]);
+    char byte;
+    bool locked = read(pipe_fds[0], &byte, 1) == 1;
+    close(pipe_fds[0]);
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+    return locked ? 0 : -1;
+}
+
+// TID of the registry lock's holder, 0 when free (glibc mutex layout).
+// Workers are single-threaded, so this is the worker's pid
+static pid_t lockOwner(const SharedHandleMap* map) {
+    return __atomic_load_n(&map->lock.__data.__owner, __ATOMIC_RELAXED);
+}
+
+enum class TrialFault {
+    None,
+    DeadHolder,   // Lock left held (and entries half-written) by a killed process
+    KillWorkers,  // A quarter of the workers SIGKILLed mid-run, holding the lock if caught
+};
+
+// One trial in a fresh process, so every N starts from an empty registry.
+// Returns 0 if every check passed
+static int runTrial(int workers, const StressConfig& config, TrialFault fault) {
+    WrapperState& state = WrapperState::getInstance();
+    int reg_fd = state.getRegistryFd();  // Creates this process's registry
+    if (reg_fd < 0) return 1;
+    const SharedHandleMap* map = (const SharedHandleMap*)mmap(NULL, sizeof(SharedHandleMap),
+                                                              PROT_READ, MAP_SHARED, reg_fd, 0);
+    if (map == MAP_FAILED) return 1;
+
+    SharedTrial* trial = (SharedTrial*)mmap(NULL, sizeof(SharedTrial), PROT_READ | PROT_WRITE,
+                                            MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (trial == MAP_FAILED) return 1;
+    const int fds_per_worker = std::min(config.fds_per_worker, MAX_SHARED_HANDLES / workers);
+
+    // 1. Optionally leave the lock held by a dead process
+    int probe_fd = memfd_create("registry_stress_probe", MFD_CLOEXEC);
+    if (fault == TrialFault::DeadHolder && (probe_fd < 0 || killLockHolder(probe_fd) < 0)) {
+        fprintf(stderr, "Failed to set up a dead lock holder\n");
+        return 1;
+    }
+
+    // 2. Ring of socketpairs: worker i sends on pairs[i], receives on pairs[i - 1]
+    std::vector<std::pair<int, int>> pairs(workers);
+    for (auto& pair : pairs) {
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) return 1;
+        pair = {sv[0], sv[1]};
+    }
+    std::vector<pid_t> pids;
+    for (int i = 0; i < workers; ++i) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            runWorker(i, fds_per_worker, config, trial, pairs[i].first,
+                      pairs[(i + workers - 1) % workers].second);
+        }
+        pids.push_back(pid);
+    }
+
+    // 3. Release the workers once all are ready, then wait with a deadline
+    const uint64_t deadline = nowNs() + (uint64_t)config.timeout_ms * 1000000ULL;
+    while (trial->ready.load() < workers && nowNs() < deadline) {
+        usleep(100);
+    }
+    trial->go.store(1, std::memory_order_release);
+    int killed = 0, killed_holding = 0;
+    if (fault == TrialFault::KillWorkers) {
+        std::set<pid_t> live(pids.begin(), pids.end());
+        for (int i = 0; i < std::max(1, workers / 4); ++i) {
+            // Prefer the worker inside its critical section
+            pid_t victim = 0;
+            for (int spins = 0; spins < 100000 && !victim; ++spins) {
+                pid_t owner = lockOwner(map);
+                if (owner > 0 && live.count(owner)) {
+                    victim = owner;
+                    killed_holding++;
+                } else {
+                    sched_yield();
+                }
+            }
+            if (!victim) victim = *live.begin();
+            kill(victim, SIGKILL);
+            live.erase(victim);
+            killed++;
+        }
+    }
+    int stuck = 0;
+    for (pid_t pid : pids) {
+        int status;
+        while (waitpid(pid, &status, WNOHANG) == 0) {
+            if (nowNs() >= deadline) {
+                kill(pid, SIGKILL);
+                waitpid(pid, &status, 0);
+                stuck++;
+                break;
+            }
+            usleep(1000);
+        }
+    }
+
+    // 4. Aggregate throughput and latency
+    uint64_t hist[HIST_BUCKETS] = {};
+    uint64_t ops = 0, writes = 0, missed = 0, errors = 0, elapsed = 1;
+    for (int i = 0; i < workers; ++i) {
+        const WorkerResult& result = trial->workers[i];
+        if (!result.done.load()) continue;
+        ops += result.ops;
+        writes += result.writes;
+        missed += result.missed_lookups;
+        errors += result.errors;
+        elapsed = std::max(elapsed, result.elapsed_ns);
+        for (int b = 0; b < HIST_BUCKETS; ++b) hist[b] += result.hist[b];
+    }
+
+    // 5. Registry contents: every marked identity exactly once, read-only
+    std::set<std::pair<dev_t, ino_t>> present;
+    int duplicates = 0, lost = 0;
+    int count = std::min(map->handle_count.load(), MAX_SHARED_HANDLES);
+    for (int i = 0; i < count; ++i) {
+        const SharedHandleMap::HandleEntry& entry = map->entries[i];
+        if (entry.state.load() != ENTRY_VALID || !entry.is_readonly.load()) continue;
+        if (!present.insert({entry.dev, entry.ino}).second) duplicates++;
+    }
+    for (int i = 0; i < workers * fds_per_worker; ++i) {
+        const SharedTrial::Identity& id = trial->identities[i];
+        if (!present.count({id.dev, id.ino})) lost++;
+    }
+
+    printf("%7d %12.0f %9.2f %9.2f %9.2f %9.2f %8d %6d %6d %7llu %6d\n",
+           workers, ops * 1e9 / elapsed,
+           percentileUs(hist, ops, 0.50), percentileUs(hist, ops, 0.99),
+           percentileUs(hist, ops, 0.999), percentileUs(hist, ops, 1.0),
+           count, lost, duplicates, (unsigned long long)missed, stuck);
+    if (errors) {
+        printf("        %llu worker setup errors\n", (unsigned long long)errors);
+    }
+    // Killed workers report nothing; only survivors count
+    bool repaired = true;
+    if (fault == TrialFault::DeadHolder) {
+        std::vector<AccessRange> ranges;
+        size_t granularity = 0;
+        repaired = state.isFdReadOnly(probe_fd, &ranges, &granularity) && ranges.empty();
+        printf("Lock holder killed mid-write before the run: %s, probe entry %s\n",
+               stuck ? "NOT recovered, workers stuck" : "recovered",
+               repaired ? "repaired read-only" : "NOT repaired");
+    } else if (fault == TrialFault::KillWorkers) {
+        printf("Killed %d of %d workers mid-run (%d holding the lock): %s\n", killed, workers,
+               killed_holding, stuck ? "NOT recovered, survivors stuck" : "survivors finished");
+    }
+    return (lost || duplicates || missed || errors || stuck || !repaired) ? 1 : 0;
+}
+
+static std::vector<int> parseCounts(const char* list) {
+    std::vector<int> counts;
+    for (const char* p = list; *p;) {
+        int n = atoi(p);
+        if (n > 0 && n <= MAX_WORKERS) counts.push_back(n);
+        p = strchr(p, ',');
+        if (!p) break;
+        ++p;
+    }
+    return counts;
+}
+
+int main(int argc, char** argv) {
+    StressConfig config = {{1, 2, 4, 8, 16, 32, 64}, 20000, 0, 10, 8, false, 10000};
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            config.worker_counts = parseCounts(argv[++i]);
+        } else if (strcmp(argv[i], "--ops") == 0 && i + 1 < argc) {
+            config.ops = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            config.rate = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--write-percent") == 0 && i + 1 < argc) {
+            config.write_percent = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--fds-per-worker") == 0 && i + 1 < argc) {
+            config.fds_per_worker = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--kill-holder") == 0) {
+            config.kill_holder = true;
+        } else if (strcmp(argv[i], "--timeout-ms") == 0 && i + 1 < argc) {
+            config.timeout_ms = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--workers 1,2,4,...] [--ops N] [--rate OPS_PER_SEC] "
+                    "[--write-percent P] [--fds-per-worker K] [--kill-holder] [--timeout-ms MS]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (config.worker_counts.empty()) {
+        fprintf(stderr, "--workers needs counts between 1 and %d\n", MAX_WORKERS);
+        return 1;
+    }
+
+    // Per-op info logging would dominate the measurement
+    setenv("CUDA_RO_WRAPPER_LOG", "0", 0);
+
+    printf("=== Wrapper Registry Stress (%llu ops/worker, %d%% writes, %s) ===\n",
+           (unsigned long long)config.ops, config.write_percent,
+           config.rate ? (std::to_string(config.rate) + " ops/s/worker").c_str() : "unthrottled");
+    printf("%7s %12s %9s %9s %9s %9s %8s %6s %6s %7s %6s\n", "workers", "ops/s", "p50 us",
+           "p99 us", "p99.9 us", "max us", "entries", "lost", "dups", "missed", "stuck");
+
+    int failures = 0;
+    auto trial = [&](int workers, TrialFault fault) {
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid == 0) {
+            int rc = runTrial(workers, config, fault);
+            fflush(stdout);
+            _exit(rc);
+        }
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) failures++;
+    };
+    for (int workers : config.worker_counts) {
+        trial(workers, TrialFault::None);
+    }
+
+    // Throughput after a dead lock holder should match the row above
+    if (config.kill_holder) {
+        trial(config.worker_counts.back(), TrialFault::DeadHolder);
+        // All writes, so kills often land inside the critical section
+        config.write_percent = 100;
+        trial(config.worker_counts.back(), TrialFault::KillWorkers);
+    }
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
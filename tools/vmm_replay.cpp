@@ -0,0 +1,278 @@
+// Replay a libcuda_ro_wrapper.so VMM trace against the real driver or the
+// host emulation and report per-call latency distributions
+#include "cuda_ipc_common.h"
+#include "cuda_ro_trace.h"
+#include "vmm_driver.h"
+#include "vmm_emulation.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+struct LatencyStats {
+    std::vector<uint64_t> recorded_ns;
+    std::vector<uint64_t> replay_ns;
+    uint64_t replay_failures = 0;
+};
+
+// Recorded VA reservations mapped onto the replay's reservations
+class AddressTranslator {
+public:
+    void add(CUdeviceptr recorded, CUdeviceptr replayed, size_t size) {
+        ranges_[recorded] = {replayed, size};
+    }
+
+    void remove(CUdeviceptr recorded) {
+        ranges_.erase(recorded);
+    }
+
+    // Pointers inside a reservation keep their offset from its base
+    bool translate(CUdeviceptr recorded, CUdeviceptr& replayed) const {
+        auto it = ranges_.upper_bound(recorded);
+        if (it == ranges_.begin()) return false;
+        --it;
+        if (recorded >= it->first + it->second.second) return false;
+        replayed = it->second.first + (recorded - it->first);
+        return true;
+    }
+
+private:
+    std::map<CUdeviceptr, std::pair<CUdeviceptr, size_t>> ranges_;
+};
+
+static void printDistribution(const char* label, std::vector<uint64_t>& samples) {
+    if (samples.empty()) {
+        printf("    %-8s %8s\n", label, "-");
+        return;
+    }
+    std::sort(samples.begin(), samples.end());
+    auto pct = [&](double p) {
+        return samples[std::min(samples.size() - 1, (size_t)(p * samples.size()))] / 1000.0;
+    };
+    printf("    %-8s %8zu  p50 %9.1f  p90 %9.1f  p99 %9.1f  max %9.1f us\n",
+           label, samples.size(), pct(0.50), pct(0.90), pct(0.99), samples.back() / 1000.0);
+}
+
+int main(int argc, char** argv) {
+    const char* path = nullptr;
+    bool emulated = false;
+    bool dump = false;
+    uint64_t latency_us = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--emulated") == 0) {
+            emulated = true;
+        } else if (strcmp(argv[i], "--latency-us") == 0 && i + 1 < argc) {
+            latency_us = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--dump") == 0) {
+            dump = true;
+        } else if (!path) {
+            path = argv[i];
+        } else {
+            path = nullptr;
+            break;
+        }
+    }
+    if (!path) {
+        fprintf(stderr, "Usage: %s <trace> [--emulated [--latency-us N]] [--dump]\n", argv[0]);
+        return 1;
+    }
+
+    // 1. Map and validate the trace
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(CuRoTraceHeader)) {
+        fprintf(stderr, "Cannot read trace %s\n", path);
+        return 1;
+    }
+    void* addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+        fprintf(stderr, "Cannot map trace %s\n", path);
+        return 1;
+    }
+    const CuRoTraceHeader* header = (const CuRoTraceHeader*)addr;
+    if (header->magic != CU_RO_TRACE_MAGIC || header->version != CU_RO_TRACE_VERSION ||
+        header->record_size != sizeof(CuRoTraceRecord)) {
+        fprintf(stderr, "%s is not a version %d VMM trace\n", path, CU_RO_TRACE_VERSION);
+        return 1;
+    }
+    uint64_t slots = std::min<uint64_t>(header->next_record, header->capacity);
+    slots = std::min<uint64_t>(slots, (st.st_size - sizeof(CuRoTraceHeader)) / sizeof(CuRoTraceRecord));
+    const CuRoTraceRecord* all_records = (const CuRoTraceRecord*)(header + 1);
+
+    // 2. Collect used slots in call order
+    std::vector<CuRoTraceRecord> records;
+    for (uint64_t i = 0; i < slots; ++i) {
+        if (all_records[i].call_id != TRACE_CALL_NONE) {
+            records.push_back(all_records[i]);
+        }
+    }
+    std::stable_sort(records.begin(), records.end(),
+        [](const CuRoTraceRecord& a, const CuRoTraceRecord& b) {
+            return a.timestamp_ns < b.timestamp_ns;
+        });
+    printf("Trace %s: pid %d, %zu calls, %llu dropped\n", path, header->pid,
+           records.size(), (unsigned long long)header->dropped);
+
+    if (dump) {
+        for (const CuRoTraceRecord& r : records) {
+            printf("%12.3f us  tid %-7u %-31s result %-4d %8.1f us  args %llx %llx %llx %llx %llx\n",
+                   (r.timestamp_ns - header->start_ns) / 1000.0, r.tid,
+                   cuRoTraceCallName(r.call_id), r.result, r.duration_ns / 1000.0,
+                   (unsigned long long)r.args[0], (unsigned long long)r.args[1],
+                   (unsigned long long)r.args[2], (unsigned long long)r.args[3],
+                   (unsigned long long)r.args[4]);
+        }
+        return 0;
+    }
+
+    // 3. Imports can't be replayed without the exporter's FD; replay them as
+    //    creates sized by the largest mapping of the imported handle
+    std::unordered_map<uint64_t, size_t> import_sizes;
+    for (const CuRoTraceRecord& r : records) {
+        if (r.call_id == TRACE_MEM_MAP && r.result == CUDA_SUCCESS) {
+            size_t& size = import_sizes[r.args[3]];
+            size = std::max<size_t>(size, r.args[2] + r.args[1]);
+        }
+    }
+
+    // 4. Pick the driver
+    const VmmDriver* driver;
+    CUdevice device = 0;
+    if (emulated) {
+        VmmEmulationConfig config = defaultVmmEmulationConfig();
+        for (int call = 0; call < VMM_EMU_CALL_COUNT; ++call) {
+            config.latency_ns[call] = latency_us * 1000;
+        }
+        configureVmmEmulation(config);
+        driver = &emulatedVmmDriver();
+    } else {
+#ifdef VMM_REPLAY_EMULATION_ONLY
+        fprintf(stderr, "This build has no libcuda; replay with --emulated\n");
+        return 1;
+#else
+        device = initCudaDevice(0);
+        createCudaContext(device);
+        driver = &realVmmDriver();
+#endif
+    }
+    printf("Replaying against %s driver\n", driver->name);
+
+    // 5. Replay in timestamp order, translating handles and addresses
+    std::unordered_map<uint64_t, CUmemGenericAllocationHandle> handles;
+    AddressTranslator addresses;
+    std::vector<LatencyStats> stats(TRACE_CALL_COUNT);
+    uint64_t skipped = 0;
+
+    for (const CuRoTraceRecord& r : records) {
+        if (r.result != CUDA_SUCCESS || r.call_id == TRACE_CU_INIT) {
+            ++skipped;  // Only successful VMM calls are replayed
+            continue;
+        }
+
+        CUmemAllocationProp prop = {};
+        prop.type = CU_MEM_ALLOCATION_TYPE_PINNED;
+        prop.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+        prop.location.id = device;
+        prop.requestedHandleTypes = CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR;
+
+        CUresult result = CUDA_ERROR_INVALID_VALUE;
+        CUmemGenericAllocationHandle handle = 0;
+        CUdeviceptr ptr = 0;
+        uint64_t start = monotonicNowNs();
+
+        switch (r.call_id) {
+        case TRACE_MEM_CREATE:
+            result = driver->memCreate(&handle, r.args[1], &prop, 0);
+            if (result == CUDA_SUCCESS) handles[r.args[0]] = handle;
+            break;
+        case TRACE_MEM_IMPORT:
+            result = import_sizes.count(r.args[0])
+                ? driver->memCreate(&handle, import_sizes[r.args[0]], &prop, 0)
+                : CUDA_ERROR_NOT_SUPPORTED;
+            if (result == CUDA_SUCCESS) handles[r.args[0]] = handle;
+            break;
+        case TRACE_MEM_RELEASE:
+            if (handles.count(r.args[0])) {
+                result = driver->memRelease(handles[r.args[0]]);
+                handles.erase(r.args[0]);
+            }
+            break;
+        case TRACE_MEM_ADDRESS_RESERVE:
+            result = driver->memAddressReserve(&ptr, r.args[1], r.args[2], 0, 0);
+            if (result == CUDA_SUCCESS) addresses.add(r.args[0], ptr, r.args[1]);
+            break;
+        case TRACE_MEM_ADDRESS_FREE:
+            if (addresses.translate(r.args[0], ptr)) {
+                result = driver->memAddressFree(ptr, r.args[1]);
+                addresses.remove(r.args[0]);
+            }
+            break;
+        case TRACE_MEM_MAP:
+            if (addresses.translate(r.args[0], ptr) && handles.count(r.args[3])) {
+                result = driver->memMap(ptr, r.args[1], r.args[2], handles[r.args[3]], 0);
+            }
+            break;
+        case TRACE_MEM_UNMAP:
+            if (addresses.translate(r.args[0], ptr)) {
+                result = driver->memUnmap(ptr, r.args[1]);
+            }
+            break;
+        case TRACE_MEM_SET_ACCESS:
+            if (addresses.translate(r.args[0], ptr)) {
+                CUmemAccessDesc accessDesc = {};
+                accessDesc.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+                accessDesc.location.id = device;
+                accessDesc.flags = (CUmemAccess_flags)r.args[2];
+                result = driver->memSetAccess(ptr, r.args[1], &accessDesc, 1);
+            }
+            break;
+        case TRACE_MEM_EXPORT:
+            if (handles.count(r.args[0])) {
+                int exported_fd = -1;
+                result = driver->memExportToShareableHandle(&exported_fd, handles[r.args[0]],
+                    CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR, 0);
+                if (exported_fd >= 0) ::close(exported_fd);
+            }
+            break;
+        default:
+            ++skipped;
+            continue;
+        }
+
+        uint64_t elapsed = monotonicNowNs() - start;
+        LatencyStats& call_stats = stats[r.call_id];
+        call_stats.recorded_ns.push_back(r.duration_ns);
+        if (result == CUDA_SUCCESS) {
+            call_stats.replay_ns.push_back(elapsed);
+        } else {
+            call_stats.replay_failures++;
+        }
+    }
+
+    // 6. Report
+    printf("Skipped %llu records (failed in trace, cuInit, or unknown)\n",
+           (unsigned long long)skipped);
+    for (int call = TRACE_CU_INIT; call < TRACE_CALL_COUNT; ++call) {
+        LatencyStats& call_stats = stats[call];
+        if (call_stats.recorded_ns.empty()) continue;
+        printf("  %s (%llu replay failures)\n", cuRoTraceCallName(call),
+               (unsigned long long)call_stats.replay_failures);
+        printDistribution("recorded", call_stats.recorded_ns);
+        printDistribution("replay", call_stats.replay_ns);
+    }
+
+    munmap(addr, st.st_size);
+    ::close(fd);
+#ifndef VMM_REPLAY_EMULATION_ONLY
+    if (!emulated) {
+        CHECK_CUDA(cuDevicePrimaryCtxRelease(device));
+    }
+#endif
+    return 0;
+}
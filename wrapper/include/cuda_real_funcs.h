@@ -7,22 +7,87 @@
 typedef CUresult (*cuInit_t)(unsigned int);
 typedef CUresult (*cuMemCreate_t)(CUmemGenericAllocationHandle*, size_t, const CUmemAllocationProp*, unsigned long long);
 typedef CUresult (*cuMemRelease_t)(CUmemGenericAllocationHandle);
+typedef CUresult (*cuMemAddressReserve_t)(CUdeviceptr*, size_t, size_t, CUdeviceptr, unsigned long long);
+typedef CUresult (*cuMemAddressFree_t)(CUdeviceptr, size_t);
 typedef CUresult (*cuMemMap_t)(CUdeviceptr, size_t, size_t, CUmemGenericAllocationHandle, unsigned long long);
 typedef CUresult (*cuMemUnmap_t)(CUdeviceptr, size_t);
 typedef CUresult (*cuMemSetAccess_t)(CUdeviceptr, size_t, const CUmemAccessDesc*, size_t);
 typedef CUresult (*cuMemExportToShareableHandle_t)(void*, CUmemGenericAllocationHandle, CUmemAllocationHandleType, unsigned long long);
 typedef CUresult (*cuMemImportFromShareableHandle_t)(CUmemGenericAllocationHandle*, void*, CUmemAllocationHandleType);
+typedef CUresult (*cuMemGetAllocationGranularity_t)(size_t*, const CUmemAllocationProp*, CUmemAllocationGranularity_flags);
+
+// Copy and memset entry points that can write device memory
+typedef CUresult (*cuMemcpy_t)(CUdeviceptr, CUdeviceptr, size_t);
+typedef CUresult (*cuMemcpyAsync_t)(CUdeviceptr, CUdeviceptr, size_t, CUstream);
+typedef CUresult (*cuMemcpyHtoD_t)(CUdeviceptr, const void*, size_t);
+typedef CUresult (*cuMemcpyHtoDAsync_t)(CUdeviceptr, const void*, size_t, CUstream);
+typedef CUresult (*cuMemcpyDtoD_t)(CUdeviceptr, CUdeviceptr, size_t);
+typedef CUresult (*cuMemcpyDtoDAsync_t)(CUdeviceptr, CUdeviceptr, size_t, CUstream);
+typedef CUresult (*cuMemsetD8_t)(CUdeviceptr, unsigned char, size_t);
+typedef CUresult (*cuMemsetD16_t)(CUdeviceptr, unsigned short, size_t);
+typedef CUresult (*cuMemsetD32_t)(CUdeviceptr, unsigned int, size_t);
+typedef CUresult (*cuMemsetD8Async_t)(CUdeviceptr, unsigned char, size_t, CUstream);
+typedef CUresult (*cuMemsetD16Async_t)(CUdeviceptr, unsigned short, size_t, CUstream);
+typedef CUresult (*cuMemsetD32Async_t)(CUdeviceptr, unsigned int, size_t, CUstream);
+typedef CUresult (*cuMemsetD2D8_t)(CUdeviceptr, size_t, unsigned char, size_t, size_t);
+typedef CUresult (*cuMemsetD2D16_t)(CUdeviceptr, size_t, unsigned short, size_t, size_t);
+typedef CUresult (*cuMemsetD2D32_t)(CUdeviceptr, size_t, unsigned int, size_t, size_t);
+typedef CUresult (*cuMemsetD2D8Async_t)(CUdeviceptr, size_t, unsigned char, size_t, size_t, CUstream);
+typedef CUresult (*cuMemsetD2D16Async_t)(CUdeviceptr, size_t, unsigned short, size_t, size_t, CUstream);
+typedef CUresult (*cuMemsetD2D32Async_t)(CUdeviceptr, size_t, unsigned int, size_t, size_t, CUstream);
 
 // Global function pointers structure
 struct RealCudaFunctions {
     cuInit_t cuInit;
     cuMemCreate_t cuMemCreate;
     cuMemRelease_t cuMemRelease;
+    cuMemAddressReserve_t cuMemAddressReserve;
+    cuMemAddressFree_t cuMemAddressFree;
     cuMemMap_t cuMemMap;
     cuMemUnmap_t cuMemUnmap;
     cuMemSetAccess_t cuMemSetAccess;
     cuMemExportToShareableHandle_t cuMemExportToShareableHandle;
     cuMemImportFromShareableHandle_t cuMemImportFromShareableHandle;
+    cuMemGetAllocationGranularity_t cuMemGetAllocationGranularity;  // Not intercepted
+    cuMemcpy_t cuMemcpy;
+    cuMemcpyAsync_t cuMemcpyAsync;
+    cuMemcpyHtoD_t cuMemcpyHtoD;
+    cuMemcpyHtoDAsync_t cuMemcpyHtoDAsync;
+    cuMemcpyDtoD_t cuMemcpyDtoD;
+    cuMemcpyDtoDAsync_t cuMemcpyDtoDAsync;
+    cuMemsetD8_t cuMemsetD8;
+    cuMemsetD16_t cuMemsetD16;
+    cuMemsetD32_t cuMemsetD32;
+    cuMemsetD8Async_t cuMemsetD8Async;
+    cuMemsetD16Async_t cuMemsetD16Async;
+    cuMemsetD32Async_t cuMemsetD32Async;
+    cuMemsetD2D8_t cuMemsetD2D8;
+    cuMemsetD2D16_t cuMemsetD2D16;
+    cuMemsetD2D32_t cuMemsetD2D32;
+    cuMemsetD2D8Async_t cuMemsetD2D8Async;
+    cuMemsetD2D16Async_t cuMemsetD2D16Async;
+    cuMemsetD2D32Async_t cuMemsetD2D32Async;
+
+    // Per-thread default stream variants (code built with
+    // CUDA_API_PER_THREAD_DEFAULT_STREAM calls these symbols instead)
+    cuMemcpy_t cuMemcpy_ptds;
+    cuMemcpyAsync_t cuMemcpyAsync_ptsz;
+    cuMemcpyHtoD_t cuMemcpyHtoD_ptds;
+    cuMemcpyHtoDAsync_t cuMemcpyHtoDAsync_ptsz;
+    cuMemcpyDtoD_t cuMemcpyDtoD_ptds;
+    cuMemcpyDtoDAsync_t cuMemcpyDtoDAsync_ptsz;
+    cuMemsetD8_t cuMemsetD8_ptds;
+    cuMemsetD16_t cuMemsetD16_ptds;
+    cuMemsetD32_t cuMemsetD32_ptds;
+    cuMemsetD8Async_t cuMemsetD8Async_ptsz;
+    cuMemsetD16Async_t cuMemsetD16Async_ptsz;
+    cuMemsetD32Async_t cuMemsetD32Async_ptsz;
+    cuMemsetD2D8_t cuMemsetD2D8_ptds;
+    cuMemsetD2D16_t cuMemsetD2D16_ptds;
+    cuMemsetD2D32_t cuMemsetD2D32_ptds;
+    cuMemsetD2D8Async_t cuMemsetD2D8Async_ptsz;
+    cuMemsetD2D16Async_t cuMemsetD2D16Async_ptsz;
+    cuMemsetD2D32Async_t cuMemsetD2D32Async_ptsz;
 };
 
 // External reference to global structure (defined in wrapper_init.cpp)
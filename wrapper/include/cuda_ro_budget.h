@@ -0,0 +1,55 @@
+#ifndef CUDA_RO_BUDGET_H
+#define CUDA_RO_BUDGET_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+// Node-wide GPU memory accounting shared by every process that loads
+// libcuda_ro_wrapper.so, read live by cuda_ro_usage.
+//
+// Unlike the read-only registry this is deliberately one well-known name
+// per node: the whole point is to see every co-located process. Counters
+// are plain integers updated with __atomic builtins so the layout can be
+// mapped by tools that don't link the wrapper.
+//
+// Only memory a process creates is charged to it. Imported handles share
+// the exporter's physical memory and are not counted again.
+#define CU_RO_BUDGET_SHM_NAME "/cuda_ro_wrapper_budget"
+#define CU_RO_BUDGET_MAGIC 0x5447444255524355ULL  // "UCRUBDGT"
+#define CU_RO_BUDGET_VERSION 1
+#define CU_RO_BUDGET_MAX_PROCESSES 256
+
+// Same first-use protocol as the session registry: the CAS winner moves
+// UNINITIALIZED -> INITIALIZING, fills in the header, then publishes READY
+enum CuRoBudgetInitState : uint32_t {
+    BUDGET_UNINITIALIZED = 0,
+    BUDGET_INITIALIZING = 1,
+    BUDGET_READY = 2,
+};
+
+struct CuRoBudgetProcess {
+    int32_t pid;                 // 0 = free slot, claimed with CAS
+    uint32_t soft_crossings;     // Times this process went over its soft limit
+    uint64_t private_bytes;      // Created and never exported
+    uint64_t exported_bytes;     // Created and exported to other processes
+    uint64_t peak_bytes;
+    uint64_t allocations;        // Live cuMemCreate handles
+    uint64_t denied;             // cuMemCreate calls failed by a hard limit
+    uint64_t soft_limit;         // 0 = no limit
+    uint64_t hard_limit;
+};
+
+struct CuRoBudgetMap {
+    uint32_t init_state;
+    uint32_t version;
+    uint64_t magic;
+    uint64_t node_bytes;         // Sum of private + exported over all slots
+    uint64_t node_peak_bytes;
+    uint64_t node_soft_limit;    // 0 = no limit
+    uint64_t node_hard_limit;
+    uint64_t node_denied;
+    uint64_t reclaimed_processes;  // Slots of dead processes cleaned up
+    CuRoBudgetProcess processes[CU_RO_BUDGET_MAX_PROCESSES];
+};
+
+#endif // CUDA_RO_BUDGET_H
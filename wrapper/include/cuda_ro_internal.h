@@ -3,34 +3,119 @@
 
 #include <cuda.h>
 #include <atomic>
+#include <cstdint>
+#include <map>
 #include <mutex>
 #include <unordered_map>
+#include <vector>
 #include <pthread.h>
 #include <sys/types.h>
 
+// Byte range inside one physical allocation
+struct AccessRange {
+    uint64_t offset;
+    uint64_t size;
+};
+
 // Metadata for each allocation handle (process-local)
 struct AllocationMetadata {
     CUmemGenericAllocationHandle handle;
     size_t size;
-    bool is_read_only;
-    int exported_fd;  // FD if exported, -1 otherwise
+    bool is_read_only;  // Whole handle
+    bool exported;      // Exported at least once (any handle type)
+    int exported_fd;    // POSIX FD of the first export, -1 otherwise
+    bool imported;
+    // One bit per granule that importers may only map read-only. Set by the
+    // owner before export, or received from the registry on import
+    size_t granularity;
+    std::vector<uint64_t> ro_granules;
+};
+
+// Mapping created by cuMemMap: [ptr, ptr + size) shows handle at offset
+struct MappingInfo {
+    CUmemGenericAllocationHandle handle;
+    size_t size;
+    size_t offset;
 };
 
 // Shared memory structure for cross-process tracking
 // Track by (dev, ino) which is invariant across FD passing via SCM_RIGHTS
 #define MAX_SHARED_HANDLES 1024
+#define SHARED_HANDLE_MAP_MAGIC 0x43524f52u  // "CROR"
+#define MAX_RO_RANGES 16
+
+// First-use initialization: the CAS winner moves UNINITIALIZED -> INITIALIZING,
+// sets up the lock and entries, then publishes READY; everyone else waits
+enum RegistryInitState : uint32_t {
+    REGISTRY_UNINITIALIZED = 0,
+    REGISTRY_INITIALIZING = 1,
+    REGISTRY_READY = 2,
+};
+
+// Entries are published with a release store of ENTRY_VALID after their
+// fields are written, so lookups can scan without taking the lock
+enum RegistryEntryState : uint32_t {
+    ENTRY_EMPTY = 0,
+    ENTRY_WRITING = 1,
+    ENTRY_VALID = 2,
+};
 
+// One registry per producer session, backed by a memfd that is handed to
+// the session's consumers over the IPC socket (never a global /dev/shm name)
 struct SharedHandleMap {
+    std::atomic<uint32_t> init_state;
+    uint32_t magic;
+    pid_t creator_pid;
     std::atomic<int> handle_count;
     struct HandleEntry {
+        std::atomic<uint32_t> state;
         dev_t dev;     // Device ID from fstat (identifies filesystem)
         ino_t ino;     // Inode number from fstat (unique within filesystem)
-        std::atomic<bool> is_readonly;
+        std::atomic<bool> is_readonly;  // Whole handle
         pid_t owner_pid;
+        // Read-only sub-ranges when the handle is not wholly read-only.
+        // Seqlock: odd while the owner rewrites them, readers retry
+        std::atomic<uint32_t> range_seq;
+        pid_t range_writer_pid;  // Last process to take range_seq odd
+        uint32_t range_count;
+        uint64_t granularity;
+        AccessRange ranges[MAX_RO_RANGES];
     } entries[MAX_SHARED_HANDLES];
+    // Serializes writers; readers are lock-free. Robust: if a writer dies
+    // holding it, the next one gets EOWNERDEAD and repairs the table
     pthread_mutex_t lock;
 };
 
+// Device VA intervals that copies and memsets must not write: every mapping
+// of an imported read-only handle, and the read-only granule ranges behind
+// mappings of partially read-only imports. WrapperState rebuilds it under its
+// mutex whenever mappings change; readers never lock. A seqlock guards the
+// sorted interval arrays, and each thread caches the last interval or gap it
+// hit, so repeated copies to one buffer cost a single atomic load
+class ReadOnlyRangeIndex {
+public:
+    static constexpr size_t CAPACITY = 4096;
+
+    ReadOnlyRangeIndex();
+
+    // Writer side (serialized by the caller). Intervals must be sorted and
+    // disjoint; more than CAPACITY marks the index overflowed
+    void publish(const std::vector<AccessRange>& intervals);
+
+    enum Lookup { ALLOWED, BLOCKED, OVERFLOWED };
+
+    // BLOCKED if [ptr, ptr + size) overlaps a read-only interval; OVERFLOWED
+    // when the published snapshot could not hold every interval
+    Lookup overlaps(CUdeviceptr ptr, size_t size) const;
+
+private:
+    std::atomic<uint32_t> seq_;  // Odd while publishing
+    std::atomic<uint32_t> count_;
+    std::atomic<bool> overflowed_;
+    std::atomic<uint64_t> starts_[CAPACITY];
+    std::atomic<uint64_t> ends_[CAPACITY];
+};
+
 // Thread-safe global state singleton
 class WrapperState {
 public:
@@ -40,20 +125,48 @@ public:
     void initSharedMemory();
     void cleanupSharedMemory();
 
+    // Per-session registry handoff
+    int getRegistryFd();             // New read-only FD for consumers, -1 on error
+    int attachRegistry(int fd);      // Attach a producer session's registry
+
     // Allocation tracking (process-local)
-    void registerAllocation(CUmemGenericAllocationHandle handle, size_t size);
+    void registerAllocation(CUmemGenericAllocationHandle handle, size_t size,
+                            size_t granularity = 0);
     void markAsReadOnly(CUmemGenericAllocationHandle handle);
-    void unregisterAllocation(CUmemGenericAllocationHandle handle);
+    // Owner side, before export: per-granule access importers will get
+    int setRangeAccess(CUmemGenericAllocationHandle handle, size_t offset, size_t size,
+                       bool read_only);
+    // Coalesced read-only ranges of an owned handle (empty if none)
+    void getReadOnlyRanges(CUmemGenericAllocationHandle handle, std::vector<AccessRange>& ranges,
+                           size_t& granularity);
+    // Importer side: apply ranges received through the registry
+    void markImported(CUmemGenericAllocationHandle handle, const std::vector<AccessRange>& ranges,
+                      size_t granularity);
+    // Removes the allocation; fills *removed with its metadata if it was known
+    bool unregisterAllocation(CUmemGenericAllocationHandle handle,
+                              AllocationMetadata* removed = nullptr);
+    // Records an export; returns the size on the first export, else 0
+    size_t markExported(CUmemGenericAllocationHandle handle, int fd);
     bool isHandleReadOnly(CUmemGenericAllocationHandle handle);
 
     // FD tracking (cross-process via shared memory using dev/ino)
     void markFdAsReadOnly(int fd);
-    bool isFdReadOnly(int fd);
+    // Publishes read-only sub-ranges for an FD exported read-write
+    void markFdRanges(int fd, const std::vector<AccessRange>& ranges, size_t granularity);
+    // Whole-handle read-only status; also returns the FD's read-only
+    // sub-ranges when asked
+    bool isFdReadOnly(int fd, std::vector<AccessRange>* ranges = nullptr,
+                      size_t* granularity = nullptr);
 
     // Device pointer tracking (for runtime checks)
-    void registerMapping(CUdeviceptr ptr, CUmemGenericAllocationHandle handle, size_t size);
+    void registerMapping(CUdeviceptr ptr, CUmemGenericAllocationHandle handle, size_t size,
+                         size_t offset);
     void unregisterMapping(CUdeviceptr ptr);
-    bool isDevicePtrReadOnly(CUdeviceptr ptr);
+    // True if any part of [ptr, ptr + size) maps read-only memory
+    bool isDeviceRangeReadOnly(CUdeviceptr ptr, size_t size);
+    // Copy/memset check: true if [ptr, ptr + size) overlaps read-only memory
+    // this process imported. Lock-free unless the range index overflowed
+    bool isWriteBlocked(CUdeviceptr ptr, size_t size);
 
 private:
     WrapperState();
@@ -64,14 +177,56 @@ private:
     // Process-local state
     std::mutex mutex_;
     std::unordered_map<CUmemGenericAllocationHandle, AllocationMetadata> allocations_;
-    std::unordered_map<CUdeviceptr, CUmemGenericAllocationHandle> ptr_to_handle_;
+    std::map<CUdeviceptr, MappingInfo> mappings_;  // Ordered: range lookups
+    ReadOnlyRangeIndex write_index_;
+
+    void rebuildWriteIndex();  // Caller holds mutex_
+    bool isRangeReadOnlyLocked(CUdeviceptr ptr, size_t size, bool imported_only);
 
-    // Shared memory for cross-process tracking
+    bool ensureSessionRegistry();
+    bool lockRegistry();            // Caller holds registry_mutex_
+    void repairRegistryLocked();    // After EOWNERDEAD, before marking consistent
+    SharedHandleMap::HandleEntry* addOrFindEntry(dev_t dev, ino_t ino, bool readonly);
+    static int findEntry(const SharedHandleMap* map, dev_t dev, ino_t ino);
+
+    // This process's own session registry, created on first use
+    std::mutex registry_mutex_;
     int shm_fd_;
     SharedHandleMap* shared_handle_map_;
-    static constexpr const char* SHM_NAME = "/cuda_ro_wrapper_handles";
+
+    // Registries of producer sessions this process has attached (read-only)
+    struct AttachedRegistry {
+        int fd;
+        dev_t dev;
+        ino_t ino;
+        const SharedHandleMap* map;
+    };
+    std::vector<AttachedRegistry> attached_;
+
+    static constexpr const char* REGISTRY_FD_ENV = "CUDA_RO_WRAPPER_REGISTRY_FD";
 };
 
+// VMM call tracing (enabled by CUDA_RO_WRAPPER_TRACE=<path>)
+extern std::atomic<bool> g_trace_enabled;
+uint64_t trace_now_ns();
+void trace_init();
+void trace_shutdown();
+void trace_record(uint16_t call_id, uint64_t begin_ns, CUresult result,
+                  uint64_t a0 = 0, uint64_t a1 = 0, uint64_t a2 = 0,
+                  uint64_t a3 = 0, uint64_t a4 = 0);
+
+// Start timestamp for a traced call, 0 when tracing is off
+inline uint64_t trace_begin() {
+    return g_trace_enabled.load(std::memory_order_relaxed) ? trace_now_ns() : 0;
+}
+
+// GPU memory budget accounting (node-wide shm, see cuda_ro_budget.h)
+void budget_init();
+void budget_shutdown();
+bool budget_charge(size_t size);  // false: a hard limit would be exceeded
+void budget_uncharge(size_t size, bool exported);
+void budget_mark_exported(size_t size);
+
 // Logging utilities
 void log_info(const char* format, ...);
 void log_error(const char* format, ...);
@@ -0,0 +1,69 @@
+#ifndef CUDA_RO_TRACE_H
+#define CUDA_RO_TRACE_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+// Binary trace of intercepted VMM calls, written by libcuda_ro_wrapper.so
+// when CUDA_RO_WRAPPER_TRACE=<path> is set and read by vmm_replay.
+//
+// File layout: one CuRoTraceHeader, then `capacity` fixed-size records.
+// Threads claim chunks of CU_RO_TRACE_CHUNK records and fill them in place,
+// so records are grouped by thread; readers sort by timestamp and skip
+// unused slots (call_id == TRACE_CALL_NONE).
+#define CU_RO_TRACE_MAGIC 0x4543415254524355ULL  // "UCRTRACE"
+#define CU_RO_TRACE_VERSION 1
+#define CU_RO_TRACE_CHUNK 256
+#define CU_RO_TRACE_ARGS 5
+
+enum CuRoTraceCall : uint16_t {
+    TRACE_CALL_NONE = 0,
+    TRACE_CU_INIT,
+    TRACE_MEM_CREATE,            // args: handle, size, flags, location id
+    TRACE_MEM_RELEASE,           // args: handle
+    TRACE_MEM_ADDRESS_RESERVE,   // args: ptr, size, alignment, addr hint, flags
+    TRACE_MEM_ADDRESS_FREE,      // args: ptr, size
+    TRACE_MEM_MAP,               // args: ptr, size, offset, handle, flags
+    TRACE_MEM_UNMAP,             // args: ptr, size
+    TRACE_MEM_SET_ACCESS,        // args: ptr, size, flags[0], count, location id
+    TRACE_MEM_EXPORT,            // args: handle, handle type, flags, fd
+    TRACE_MEM_IMPORT,            // args: handle, fd, handle type
+    TRACE_CALL_COUNT
+};
+
+struct CuRoTraceHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t capacity;           // Records the file can hold
+    uint64_t next_record;        // Next unclaimed slot (updated atomically)
+    uint64_t dropped;            // Calls not recorded because the file was full
+    uint64_t start_ns;           // CLOCK_MONOTONIC when tracing started
+    int32_t pid;
+    uint32_t reserved[3];
+};
+
+struct CuRoTraceRecord {
+    uint64_t timestamp_ns;       // CLOCK_MONOTONIC at call entry
+    uint64_t duration_ns;        // Time spent in the real driver call
+    uint32_t tid;
+    uint16_t call_id;
+    uint16_t flags;
+    int32_t result;
+    uint32_t reserved;
+    uint64_t args[CU_RO_TRACE_ARGS];
+};
+
+static_assert(sizeof(CuRoTraceHeader) == 64, "trace header layout changed");
+static_assert(sizeof(CuRoTraceRecord) == 72, "trace record layout changed");
+
+static inline const char* cuRoTraceCallName(uint16_t call_id) {
+    static const char* const names[TRACE_CALL_COUNT] = {
+        "none", "cuInit", "cuMemCreate", "cuMemRelease", "cuMemAddressReserve",
+        "cuMemAddressFree", "cuMemMap", "cuMemUnmap", "cuMemSetAccess",
+        "cuMemExportToShareableHandle", "cuMemImportFromShareableHandle",
+    };
+    return call_id < TRACE_CALL_COUNT ? names[call_id] : "unknown";
+}
+
+#endif // CUDA_RO_TRACE_H
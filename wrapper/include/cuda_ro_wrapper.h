@@ -6,4 +6,26 @@
 // Custom read-only export flag (use bit 63 to avoid conflicts with CUDA flags)
 #define CU_MEM_EXPORT_FLAGS_READONLY (1ULL << 63)
 
+// Per-session registry handoff. Each producer's read-only marks live in a
+// private memfd; the producer sends it to its consumers, which attach it
+// before importing. Applications should resolve these with dlsym so they
+// still run when the wrapper is not preloaded.
+#define CU_RO_WRAPPER_GET_REGISTRY_FD "cuRoWrapperGetRegistryFd"
+#define CU_RO_WRAPPER_ATTACH_REGISTRY "cuRoWrapperAttachRegistry"
+#define CU_RO_WRAPPER_SET_RANGE_ACCESS "cuRoWrapperSetRangeAccess"
+
+// Returns a new read-only FD for this process's registry (caller closes), -1 on error
+typedef int (*cuRoWrapperGetRegistryFd_t)(void);
+// Attaches a registry FD received from a producer, returns 0 on success
+typedef int (*cuRoWrapperAttachRegistry_t)(int fd);
+
+// Per-range permissions inside one allocation. Before exporting `handle`
+// without CU_MEM_EXPORT_FLAGS_READONLY, the owner marks granularity-aligned
+// ranges CU_MEM_ACCESS_FLAGS_PROT_READ (importers may only map them read-only)
+// or CU_MEM_ACCESS_FLAGS_PROT_READWRITE (the default). Importers' cuMemSetAccess
+// is checked against the ranges behind each mapping's offset. Returns 0 on
+// success, -1 on misaligned ranges, unknown or already exported handles
+typedef int (*cuRoWrapperSetRangeAccess_t)(CUmemGenericAllocationHandle handle, size_t offset,
+                                           size_t size, CUmemAccess_flags access);
+
 #endif // CUDA_RO_WRAPPER_H
\ No newline at end of file
@@ -1,11 +1,13 @@
 #include "cuda_ro_internal.h"
 #include "cuda_real_funcs.h"
+#include "cuda_ro_trace.h"
 
 extern "C" CUresult cuMemSetAccess(CUdeviceptr ptr, size_t size,
                                     const CUmemAccessDesc* desc,
                                     size_t count) {
-    // Check if any mapped region overlaps with read-only memory
-    bool is_readonly = WrapperState::getInstance().isDevicePtrReadOnly(ptr);
+    // Check if any mapped region in the range is read-only, either the whole
+    // handle or a read-only granule range behind the mapping's offset
+    bool is_readonly = WrapperState::getInstance().isDeviceRangeReadOnly(ptr, size);
 
     log_info("cuMemSetAccess: ptr=0x%llx, is_readonly=%d, flags=0x%x",
              (unsigned long long)ptr, is_readonly, count > 0 ? desc[0].flags : 0);
@@ -15,14 +17,25 @@ extern "C" CUresult cuMemSetAccess(CUdeviceptr ptr, size_t size,
         // READWRITE = 0x3, READ = 0x1, so check if flags == READWRITE
         for (size_t i = 0; i < count; i++) {
             if (desc[i].flags == CU_MEM_ACCESS_FLAGS_PROT_READWRITE) {
-                log_error("Rejected READWRITE access for read-only allocation at 0x%llx",
-                         (unsigned long long)ptr);
+                log_error("Rejected READWRITE access for read-only memory in [0x%llx, +0x%zx)",
+                         (unsigned long long)ptr, size);
                 log_error("Consumer must use CU_MEM_ACCESS_FLAGS_PROT_READ instead");
+                if (g_trace_enabled.load(std::memory_order_relaxed)) {
+                    trace_record(TRACE_MEM_SET_ACCESS, trace_now_ns(), CUDA_ERROR_INVALID_VALUE,
+                                 ptr, size, desc[i].flags, count, desc[i].location.id);
+                }
                 return CUDA_ERROR_INVALID_VALUE;
             }
         }
     }
 
     // Call real function (allows READ-only mappings)
-    return g_real_cuda.cuMemSetAccess(ptr, size, desc, count);
+    uint64_t trace_start = trace_begin();
+    CUresult result = g_real_cuda.cuMemSetAccess(ptr, size, desc, count);
+    if (trace_start) {
+        trace_record(TRACE_MEM_SET_ACCESS, trace_start, result, ptr, size,
+                     count > 0 ? desc[0].flags : 0, count,
+                     count > 0 ? desc[0].location.id : 0);
+    }
+    return result;
 }
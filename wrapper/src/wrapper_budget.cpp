@@ -0,0 +1,247 @@
+#include "cuda_ro_internal.h"
+#include "cuda_ro_budget.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sched.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+static CuRoBudgetMap* g_budget_map = nullptr;
+static CuRoBudgetProcess* g_budget_slot = nullptr;
+static uint64_t g_process_bytes = 0;  // Checked against the hard limit with CAS
+
+// Parse a byte count with an optional K/M/G suffix, 0 when unset
+static uint64_t parse_size_env(const char* name) {
+    const char* env = getenv(name);
+    if (!env || !*env) return 0;
+
+    char* end = nullptr;
+    uint64_t value = strtoull(env, &end, 10);
+    switch (*end) {
+    case 'G': case 'g': value <<= 30; break;
+    case 'M': case 'm': value <<= 20; break;
+    case 'K': case 'k': value <<= 10; break;
+    default: break;
+    }
+    return value;
+}
+
+static uint64_t load(const uint64_t& counter) {
+    return __atomic_load_n(&counter, __ATOMIC_RELAXED);
+}
+
+static void raise_peak(uint64_t& peak, uint64_t value) {
+    uint64_t current = load(peak);
+    while (value > current &&
+           !__atomic_compare_exchange_n(&peak, &current, value, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+// Add size to counter unless that takes it over limit (0 = no limit)
+static bool try_add(uint64_t& counter, uint64_t size, uint64_t limit, uint64_t* after) {
+    uint64_t current = load(counter);
+    do {
+        if (limit && current + size > limit) return false;
+    } while (!__atomic_compare_exchange_n(&counter, &current, current + size, true,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    *after = current + size;
+    return true;
+}
+
+// Return the bytes of processes that exited without running the destructor
+static void reclaim_dead_processes() {
+    for (int i = 0; i < CU_RO_BUDGET_MAX_PROCESSES; i++) {
+        CuRoBudgetProcess& slot = g_budget_map->processes[i];
+        int32_t pid = __atomic_load_n(&slot.pid, __ATOMIC_ACQUIRE);
+        if (pid <= 0 || kill(pid, 0) == 0 || errno != ESRCH) continue;
+
+        // -1 keeps the slot from being claimed while it is being emptied
+        if (!__atomic_compare_exchange_n(&slot.pid, &pid, -1, false,
+                                         __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            continue;
+        }
+        uint64_t bytes = load(slot.private_bytes) + load(slot.exported_bytes);
+        __atomic_fetch_sub(&g_budget_map->node_bytes, bytes, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&g_budget_map->reclaimed_processes, 1, __ATOMIC_RELAXED);
+        log_info("Reclaimed %llu bytes of exited pid %d", (unsigned long long)bytes, pid);
+        memset((char*)&slot + sizeof(slot.pid), 0, sizeof(slot) - sizeof(slot.pid));
+        __atomic_store_n(&slot.pid, 0, __ATOMIC_RELEASE);
+    }
+}
+
+void budget_init() {
+    const char* env = getenv("CUDA_RO_WRAPPER_BUDGET");
+    if (env && strcmp(env, "0") == 0) return;
+
+    // The creator widens the mode past its umask, so processes of other
+    // users can open the table read-write and are counted too
+    int fd = shm_open(CU_RO_BUDGET_SHM_NAME, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+    if (fd >= 0) {
+        if (fchmod(fd, 0666) < 0) {
+            log_error("Failed to make %s shared across users: %s", CU_RO_BUDGET_SHM_NAME,
+                      strerror(errno));
+        }
+    } else if (errno == EEXIST) {
+        fd = shm_open(CU_RO_BUDGET_SHM_NAME, O_RDWR | O_CLOEXEC, 0);
+    }
+    if (fd < 0) {
+        log_error("Budget accounting disabled: shm_open of %s failed: %s", CU_RO_BUDGET_SHM_NAME,
+                  strerror(errno));
+        return;
+    }
+
+    // Every process sizes it the same way; new pages read as zero
+    if (ftruncate(fd, sizeof(CuRoBudgetMap)) < 0) {
+        log_error("Budget accounting disabled: failed to size shm: %s", strerror(errno));
+        close(fd);
+        return;
+    }
+
+    void* addr = mmap(NULL, sizeof(CuRoBudgetMap), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        log_error("Budget accounting disabled: mmap failed: %s", strerror(errno));
+        return;
+    }
+    CuRoBudgetMap* map = (CuRoBudgetMap*)addr;
+
+    // Node limits are set once, by the process that initializes the table:
+    // a later process cannot lift the cap for everyone else
+    const uint64_t node_soft = parse_size_env("CUDA_RO_WRAPPER_NODE_SOFT_LIMIT");
+    const uint64_t node_hard = parse_size_env("CUDA_RO_WRAPPER_NODE_HARD_LIMIT");
+    uint32_t expected = BUDGET_UNINITIALIZED;
+    if (__atomic_compare_exchange_n(&map->init_state, &expected, BUDGET_INITIALIZING, false,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        map->magic = CU_RO_BUDGET_MAGIC;
+        map->version = CU_RO_BUDGET_VERSION;
+        map->node_soft_limit = node_soft;
+        map->node_hard_limit = node_hard;
+        __atomic_store_n(&map->init_state, BUDGET_READY, __ATOMIC_RELEASE);
+    } else {
+        for (int spins = 0; __atomic_load_n(&map->init_state, __ATOMIC_ACQUIRE) != BUDGET_READY; spins++) {
+            if (spins > 100000) {
+                log_error("Budget accounting disabled: shm never became ready");
+                munmap(addr, sizeof(CuRoBudgetMap));
+                return;
+            }
+            sched_yield();
+        }
+    }
+    if (map->magic != CU_RO_BUDGET_MAGIC || map->version != CU_RO_BUDGET_VERSION) {
+        log_error("Budget accounting disabled: %s has an incompatible layout", CU_RO_BUDGET_SHM_NAME);
+        munmap(addr, sizeof(CuRoBudgetMap));
+        return;
+    }
+    g_budget_map = map;
+
+    const uint64_t soft_in_effect = load(map->node_soft_limit);
+    const uint64_t hard_in_effect = load(map->node_hard_limit);
+    if (node_soft && node_soft != soft_in_effect) {
+        log_error("Ignoring CUDA_RO_WRAPPER_NODE_SOFT_LIMIT=%llu: node soft limit is %llu",
+                  (unsigned long long)node_soft, (unsigned long long)soft_in_effect);
+    }
+    if (node_hard && node_hard != hard_in_effect) {
+        log_error("Ignoring CUDA_RO_WRAPPER_NODE_HARD_LIMIT=%llu: node hard limit is %llu",
+                  (unsigned long long)node_hard, (unsigned long long)hard_in_effect);
+    }
+
+    reclaim_dead_processes();
+
+    int32_t pid = getpid();
+    for (int i = 0; i < CU_RO_BUDGET_MAX_PROCESSES; i++) {
+        CuRoBudgetProcess& slot = map->processes[i];
+        int32_t free_pid = 0;
+        if (__atomic_compare_exchange_n(&slot.pid, &free_pid, pid, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            slot.soft_limit = parse_size_env("CUDA_RO_WRAPPER_SOFT_LIMIT");
+            slot.hard_limit = parse_size_env("CUDA_RO_WRAPPER_HARD_LIMIT");
+            g_budget_slot = &slot;
+            break;
+        }
+    }
+    if (!g_budget_slot) {
+        log_error("Budget table full, pid %d is not accounted", pid);
+    }
+}
+
+void budget_shutdown() {
+    if (!g_budget_slot) return;
+
+    // The driver frees whatever the process still holds when it exits
+    CuRoBudgetProcess& slot = *g_budget_slot;
+    __atomic_fetch_sub(&g_budget_map->node_bytes, load(g_process_bytes), __ATOMIC_RELAXED);
+    memset((char*)&slot + sizeof(slot.pid), 0, sizeof(slot) - sizeof(slot.pid));
+    __atomic_store_n(&slot.pid, 0, __ATOMIC_RELEASE);
+    g_budget_slot = nullptr;
+
+    munmap(g_budget_map, sizeof(CuRoBudgetMap));
+    g_budget_map = nullptr;
+}
+
+bool budget_charge(size_t size) {
+    if (!g_budget_slot) return true;
+    CuRoBudgetProcess& slot = *g_budget_slot;
+
+    // Charge the process against its hard limit first, then the node, and
+    // undo the process charge if the node refuses
+    uint64_t process_after = 0;
+    if (!try_add(g_process_bytes, size, slot.hard_limit, &process_after)) {
+        __atomic_fetch_add(&slot.denied, 1, __ATOMIC_RELAXED);
+        log_error("cuMemCreate of %zu bytes denied: process hard limit %llu (in use %llu)",
+                  size, (unsigned long long)slot.hard_limit,
+                  (unsigned long long)load(g_process_bytes));
+        return false;
+    }
+
+    uint64_t node_after = 0;
+    uint64_t node_hard = load(g_budget_map->node_hard_limit);
+    if (!try_add(g_budget_map->node_bytes, size, node_hard, &node_after)) {
+        __atomic_fetch_sub(&g_process_bytes, size, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&slot.denied, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&g_budget_map->node_denied, 1, __ATOMIC_RELAXED);
+        log_error("cuMemCreate of %zu bytes denied: node hard limit %llu (in use %llu)",
+                  size, (unsigned long long)node_hard,
+                  (unsigned long long)load(g_budget_map->node_bytes));
+        return false;
+    }
+    raise_peak(g_budget_map->node_peak_bytes, node_after);
+
+    __atomic_fetch_add(&slot.private_bytes, size, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&slot.allocations, 1, __ATOMIC_RELAXED);
+    raise_peak(slot.peak_bytes, process_after);
+
+    // Soft limits only warn, once per crossing
+    if (slot.soft_limit && process_after > slot.soft_limit &&
+        process_after - size <= slot.soft_limit) {
+        __atomic_fetch_add(&slot.soft_crossings, 1, __ATOMIC_RELAXED);
+        log_error("Process crossed soft limit %llu (in use %llu)",
+                  (unsigned long long)slot.soft_limit, (unsigned long long)process_after);
+    }
+    uint64_t node_soft = load(g_budget_map->node_soft_limit);
+    if (node_soft && node_after > node_soft && node_after - size <= node_soft) {
+        log_error("Node crossed soft limit %llu (in use %llu)",
+                  (unsigned long long)node_soft, (unsigned long long)node_after);
+    }
+    return true;
+}
+
+void budget_uncharge(size_t size, bool exported) {
+    if (!g_budget_slot || size == 0) return;
+    CuRoBudgetProcess& slot = *g_budget_slot;
+    __atomic_fetch_sub(exported ? &slot.exported_bytes : &slot.private_bytes, size, __ATOMIC_RELAXED);
+    __atomic_fetch_sub(&slot.allocations, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_sub(&g_process_bytes, size, __ATOMIC_RELAXED);
+    __atomic_fetch_sub(&g_budget_map->node_bytes, size, __ATOMIC_RELAXED);
+}
+
+void budget_mark_exported(size_t size) {
+    if (!g_budget_slot || size == 0) return;
+    CuRoBudgetProcess& slot = *g_budget_slot;
+    __atomic_fetch_add(&slot.exported_bytes, size, __ATOMIC_RELAXED);
+    __atomic_fetch_sub(&slot.private_bytes, size, __ATOMIC_RELAXED);
+}
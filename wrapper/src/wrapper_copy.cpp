@@ -0,0 +1,251 @@
+#include "cuda_ro_internal.h"
+#include "cuda_real_funcs.h"
+
+// Copies and memsets that write device memory are checked against the
+// read-only ranges this process imported. The check is a lock-free lookup
+// (see ReadOnlyRangeIndex); passing calls go straight to the driver
+
+static bool rejectWrite(const char* call, CUdeviceptr dst, size_t bytes) {
+    if (!WrapperState::getInstance().isWriteBlocked(dst, bytes)) {
+        return false;
+    }
+    log_error("Rejected %s writing read-only memory in [0x%llx, +0x%zx)",
+              call, (unsigned long long)dst, bytes);
+    return true;
+}
+
+// 2D memsets write `height` rows of `width_bytes`, `pitch` apart. The
+// checked span runs from dst to the end of the last row (gaps included)
+static CUresult checkPitchedWrite(const char* call, CUdeviceptr dst, size_t pitch,
+                                  size_t width_bytes, size_t height) {
+    if (height == 0 || width_bytes == 0) {
+        return CUDA_SUCCESS;
+    }
+    size_t bytes;
+    uint64_t end;
+    if (__builtin_mul_overflow(pitch, height - 1, &bytes) ||
+        __builtin_add_overflow(bytes, width_bytes, &bytes) ||
+        __builtin_add_overflow((uint64_t)dst, (uint64_t)bytes, &end)) {
+        return CUDA_ERROR_INVALID_VALUE;
+    }
+    return rejectWrite(call, dst, bytes) ? CUDA_ERROR_NOT_PERMITTED : CUDA_SUCCESS;
+}
+
+extern "C" CUresult cuMemcpy(CUdeviceptr dst, CUdeviceptr src, size_t bytes) {
+    if (rejectWrite("cuMemcpy", dst, bytes)) return CUDA_ERROR_NOT_PERMITTED;
+    return g_real_cuda.cuMemcpy(dst, src, bytes);
+}
+
+extern "C" CUresult cuMemcpyAsync(CUdeviceptr dst, CUdeviceptr src, size_t bytes, CUstream stream) {
+    if (rejectWrite("cuMemcpyAsync", dst, bytes)) return CUDA_ERROR_NOT_PERMITTED;
+    return g_real_cuda.cuMemcpyAsync(dst, src, bytes, stream);
+}
+
+extern "C" CUresult cuMemcpyHtoD_v2(CUdeviceptr dst, const void* src, size_t bytes) {
+    if (rejectWrite("cuMemcpyHtoD", dst, bytes)) return CUDA_ERROR_NOT_PERMITTED;
+    return g_real_cuda.cuMemcpyHtoD(dst, src, bytes);
+}
+
+extern "C" CUresult cuMemcpyHtoDAsync_v2(CUdeviceptr dst, const void* src, size_t bytes,
+                                         CUstream stream) {
+    if (rejectWrite("cuMemcpyHtoDAsync", dst, bytes)) return CUDA_ERROR_NOT_PERMITTED;
+    return g_real_cuda.cuMemcpyHtoDAsync(dst, src, bytes, stream);
+}
+
+extern "C" CUresult cuMemcpyDtoD_v2(CUdeviceptr dst, CUdeviceptr src, size_t bytes) {
+    if (rejectWrite("cuMemcpyDtoD", dst, bytes)) return CUDA_ERROR_NOT_PERMITTED;
+    return g_real_cuda.cuMemcpyDtoD(dst, src, bytes);
+}
+
+extern "C" CUresult cuMemcpyDtoDAsync_v2(CUdeviceptr dst, CUdeviceptr src, size_t bytes,
+                                         CUstream stream) {
+    if (rejectWrite("cuMemcpyDtoDAsync", dst, bytes)) return CUDA_ERROR_NOT_PERMITTED;
+    return g_real_cuda.cuMemcpyDtoDAsync(dst, src, bytes, stream);
+}
+
+extern "C" CUresult cuMemsetD8_v2(CUdeviceptr dst, unsigned char value, size_t count) {
+    if (rejectWrite("cuMemsetD8", dst, count)) return CUDA_ERROR_NOT_PERMITTED;
+    return g_real_cuda.cuMemsetD8(dst, value, count);
+}
+
+extern "C" CUresult cuMemsetD16_v2(CUdeviceptr dst, unsigned short value, size_t count) {
+    if (rejectWrite("cuMemsetD16", dst, count * 2)) return CUDA_ERROR_NOT_PERMITTED;
+    return g_real_cuda.cuMemsetD16(dst, value, count);
+}
+
+extern "C" CUresult cuMemsetD32_v2(CUdeviceptr dst, unsigned int value, size_t count) {
+    if (rejectWrite("cuMemsetD32", dst, count * 4)) return CUDA_ERROR_NOT_PERMITTED;
+    return g_real_cuda.cuMemsetD32(dst, value, count);
+}
+
+extern "C" CUresult cuMemsetD8Async(CUdeviceptr dst, unsigned char value, size_t count,
+                                    CUstream stream) {
+    if (rejectWrite("cuMemsetD8Async", dst, count)) return CUDA_ERROR_NOT_PERMITTED;
+    return g_real_cuda.cuMemsetD8Async(dst, value, count, stream);
+}
+
+extern "C" CUresult cuMemsetD16Async(CUdeviceptr dst, unsigned short value, size_t count,
+                                     CUstream stream) {
+    if (rejectWrite("cuMemsetD16Async", dst, count * 2)) return CUDA_ERROR_NOT_PERMITTED;
+    return g_real_cuda.cuMemsetD16Async(dst, value, count, stream);
+}
+
+extern "C" CUresult cuMemsetD32Async(CUdeviceptr dst, unsigned int value, size_t count,
+                                     CUstream stream) {
+    if (rejectWrite("cuMemsetD32Async", dst, count * 4)) return CUDA_ERROR_NOT_PERMITTED;
+    return g_real_cuda.cuMemsetD32Async(dst, value, count, stream);
+}
+
+// 2D memsets (width in elements, pitch in bytes)
+
+extern "C" CUresult cuMemsetD2D8_v2(CUdeviceptr dst, size_t pitch, unsigned char value,
+                                    size_t width, size_t height) {
+    CUresult check = checkPitchedWrite("cuMemsetD2D8", dst, pitch, width, height);
+    if (check != CUDA_SUCCESS) return check;
+    return g_real_cuda.cuMemsetD2D8(dst, pitch, value, width, height);
+}
+
+extern "C" CUresult cuMemsetD2D16_v2(CUdeviceptr dst, size_t pitch, unsigned short value,
+                                     size_t width, size_t height) {
+    CUresult check = checkPitchedWrite("cuMemsetD2D16", dst, pitch, width * 2, height);
+    if (check != CUDA_SUCCESS) return check;
+    return g_real_cuda.cuMemsetD2D16(dst, pitch, value, width, height);
+}
+
+extern "C" CUresult cuMemsetD2D32_v2(CUdeviceptr dst, size_t pitch, unsigned int value,
+                                     size_t width, size_t height) {
+    CUresult check = checkPitchedWrite("cuMemsetD2D32", dst, pitch, width * 4, height);
+    if (check != CUDA_SUCCESS) return check;
+    return g_real_cuda.cuMemsetD2D32(dst, pitch, value, width, height);
+}
+
+extern "C" CUresult cuMemsetD2D8Async(CUdeviceptr dst, size_t pitch, unsigned char value,
+                                      size_t width, size_t height, CUstream stream) {
+    CUresult check = checkPitchedWrite("cuMemsetD2D8Async", dst, pitch, width, height);
+    if (check != CUDA_SUCCESS) return check;
+    return g_real_cuda.cuMemsetD2D8Async(dst, pitch, value, width, height, stream);
+}
+
+extern "C" CUresult cuMemsetD2D16Async(CUdeviceptr dst, size_t pitch, unsigned short value,
+                                       size_t width, size_t height, CUstream stream) {
+    CUresult check = checkPitchedWrite("cuMemsetD2D16Async", dst, pitch, width * 2, height);
+    if (check != CUDA_SUCCESS) return check;
+    return g_real_cuda.cuMemsetD2D16Async(dst, pitch, value, width, height, stream);
+}
+
+extern "C" CUresult cuMemsetD2D32Async(CUdeviceptr dst, size_t pitch, unsigned int value,
+                                       size_t width, size_t height, CUstream stream) {
+    CUresult check = checkPitchedWrite("cuMemsetD2D32Async", dst, pitch, width * 4, height);
+    if (check != CUDA_SUCCESS) return check;
+    return g_real_cuda.cuMemsetD2D32Async(dst, pitch, value, width, height, stream);
+}
+
+// Per-thread default stream variants: same checks, their own driver symbols
+
+extern "C" CUresult cuMemcpy_ptds(CUdeviceptr dst, CUdeviceptr src, size_t bytes) {
+    if (rejectWrite("cuMemcpy", dst, bytes)) return CUDA_ERROR_NOT_PERMITTED;
+    return g_real_cuda.cuMemcpy_ptds(dst, src, bytes);
+}
+
+extern "C" CUresult cuMemcpyAsync_ptsz(CUdeviceptr dst, CUdeviceptr src, size_t bytes,
+                                       CUstream stream) {
+    if (rejectWrite("cuMemcpyAsync", dst, bytes)) return CUDA_ERROR_NOT_PERMITTED;
+    return g_real_cuda.cuMemcpyAsync_ptsz(dst, src, bytes, stream);
+}
+
+extern "C" CUresult cuMemcpyHtoD_v2_ptds(CUdeviceptr dst, const void* src, size_t bytes) {
+    if (rejectWrite("cuMemcpyHtoD", dst, bytes)) return CUDA_ERROR_NOT_PERMITTED;
+    return g_real_cuda.cuMemcpyHtoD_ptds(dst, src, bytes);
+}
+
+extern "C" CUresult cuMemcpyHtoDAsync_v2_ptsz(CUdeviceptr dst, const void* src, size_t bytes,
+                                              CUstream stream) {
+    if (rejectWrite("cuMemcpyHtoDAsync", dst, bytes)) return CUDA_ERROR_NOT_PERMITTED;
+    return g_real_cuda.cuMemcpyHtoDAsync_ptsz(dst, src, bytes, stream);
+}
+
+extern "C" CUresult cuMemcpyDtoD_v2_ptds(CUdeviceptr dst, CUdeviceptr src, size_t bytes) {
+    if (rejectWrite("cuMemcpyDtoD", dst, bytes)) return CUDA_ERROR_NOT_PERMITTED;
+    return g_real_cuda.cuMemcpyDtoD_ptds(dst, src, bytes);
+}
+
+extern "C" CUresult cuMemcpyDtoDAsync_v2_ptsz(CUdeviceptr dst, CUdeviceptr src, size_t bytes,
+                                              CUstream stream) {
+    if (rejectWrite("cuMemcpyDtoDAsync", dst, bytes)) return CUDA_ERROR_NOT_PERMITTED;
+    return g_real_cuda.cuMemcpyDtoDAsync_ptsz(dst, src, bytes, stream);
+}
+
+extern "C" CUresult cuMemsetD8_v2_ptds(CUdeviceptr dst, unsigned char value, size_t count) {
+    if (rejectWrite("cuMemsetD8", dst, count)) return CUDA_ERROR_NOT_PERMITTED;
+    return g_real_cuda.cuMemsetD8_ptds(dst, value, count);
+}
+
+extern "C" CUresult cuMemsetD16_v2_ptds(CUdeviceptr dst, unsigned short value, size_t count) {
+    if (rejectWrite("cuMemsetD16", dst, count * 2)) return CUDA_ERROR_NOT_PERMITTED;
+    return g_real_cuda.cuMemsetD16_ptds(dst, value, count);
+}
+
+extern "C" CUresult cuMemsetD32_v2_ptds(CUdeviceptr dst, unsigned int value, size_t count) {
+    if (rejectWrite("cuMemsetD32", dst, count * 4)) return CUDA_ERROR_NOT_PERMITTED;
+    return g_real_cuda.cuMemsetD32_ptds(dst, value, count);
+}
+
+extern "C" CUresult cuMemsetD8Async_ptsz(CUdeviceptr dst, unsigned char value, size_t count,
+                                         CUstream stream) {
+    if (rejectWrite("cuMemsetD8Async", dst, count)) return CUDA_ERROR_NOT_PERMITTED;
+    return g_real_cuda.cuMemsetD8Async_ptsz(dst, value, count, stream);
+}
+
+extern "C" CUresult cuMemsetD16Async_ptsz(CUdeviceptr dst, unsigned short value, size_t count,
+                                          CUstream stream) {
+    if (rejectWrite("cuMemsetD16Async", dst, count * 2)) return CUDA_ERROR_NOT_PERMITTED;
+    return g_real_cuda.cuMemsetD16Async_ptsz(dst, value, count, stream);
+}
+
+extern "C" CUresult cuMemsetD32Async_ptsz(CUdeviceptr dst, unsigned int value, size_t count,
+                                          CUstream stream) {
+    if (rejectWrite("cuMemsetD32Async", dst, count * 4)) return CUDA_ERROR_NOT_PERMITTED;
+    return g_real_cuda.cuMemsetD32Async_ptsz(dst, value, count, stream);
+}
+
+extern "C" CUresult cuMemsetD2D8_v2_ptds(CUdeviceptr dst, size_t pitch, unsigned char value,
+                                         size_t width, size_t height) {
+    CUresult check = checkPitchedWrite("cuMemsetD2D8", dst, pitch, width, height);
+    if (check != CUDA_SUCCESS) return check;
+    return g_real_cuda.cuMemsetD2D8_ptds(dst, pitch, value, width, height);
+}
+
+extern "C" CUresult cuMemsetD2D16_v2_ptds(CUdeviceptr dst, size_t pitch, unsigned short value,
+                                          size_t width, size_t height) {
+    CUresult check = checkPitchedWrite("cuMemsetD2D16", dst, pitch, width * 2, height);
+    if (check != CUDA_SUCCESS) return check;
+    return g_real_cuda.cuMemsetD2D16_ptds(dst, pitch, value, width, height);
+}
+
+extern "C" CUresult cuMemsetD2D32_v2_ptds(CUdeviceptr dst, size_t pitch, unsigned int value,
+                                          size_t width, size_t height) {
+    CUresult check = checkPitchedWrite("cuMemsetD2D32", dst, pitch, width * 4, height);
+    if (check != CUDA_SUCCESS) return check;
+    return g_real_cuda.cuMemsetD2D32_ptds(dst, pitch, value, width, height);
+}
+
+extern "C" CUresult cuMemsetD2D8Async_ptsz(CUdeviceptr dst, size_t pitch, unsigned char value,
+                                           size_t width, size_t height, CUstream stream) {
+    CUresult check = checkPitchedWrite("cuMemsetD2D8Async", dst, pitch, width, height);
+    if (check != CUDA_SUCCESS) return check;
+    return g_real_cuda.cuMemsetD2D8Async_ptsz(dst, pitch, value, width, height, stream);
+}
+
+extern "C" CUresult cuMemsetD2D16Async_ptsz(CUdeviceptr dst, size_t pitch, unsigned short value,
+                                            size_t width, size_t height, CUstream stream) {
+    CUresult check = checkPitchedWrite("cuMemsetD2D16Async", dst, pitch, width * 2, height);
+    if (check != CUDA_SUCCESS) return check;
+    return g_real_cuda.cuMemsetD2D16Async_ptsz(dst, pitch, value, width, height, stream);
+}
+
+extern "C" CUresult cuMemsetD2D32Async_ptsz(CUdeviceptr dst, size_t pitch, unsigned int value,
+                                            size_t width, size_t height, CUstream stream) {
+    CUresult check = checkPitchedWrite("cuMemsetD2D32Async", dst, pitch, width * 4, height);
+    if (check != CUDA_SUCCESS) return check;
+    return g_real_cuda.cuMemsetD2D32Async_ptsz(dst, pitch, value, width, height, stream);
+}
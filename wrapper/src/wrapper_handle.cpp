@@ -1,6 +1,7 @@
 #include "cuda_ro_internal.h"
 #include "cuda_ro_wrapper.h"
 #include "cuda_real_funcs.h"
+#include "cuda_ro_trace.h"
 
 extern "C" CUresult cuMemExportToShareableHandle(
     void* shareableHandle,
@@ -15,7 +16,19 @@ extern "C" CUresult cuMemExportToShareableHandle(
     unsigned long long real_flags = flags & ~CU_MEM_EXPORT_FLAGS_READONLY;
 
     // Call real CUDA function
+    uint64_t trace_start = trace_begin();
     CUresult result = g_real_cuda.cuMemExportToShareableHandle(shareableHandle, handle, handleType, real_flags);
+    if (trace_start) {
+        int fd = (result == CUDA_SUCCESS && handleType == CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR)
+            ? *(int*)shareableHandle : -1;
+        trace_record(TRACE_MEM_EXPORT, trace_start, result, handle, handleType, flags, fd);
+    }
+
+    // Exported memory is reported separately from private memory
+    if (result == CUDA_SUCCESS) {
+        int fd = (handleType == CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR) ? *(int*)shareableHandle : -1;
+        budget_mark_exported(WrapperState::getInstance().markExported(handle, fd));
+    }
 
     if (result == CUDA_SUCCESS && is_readonly) {
         // Mark handle as read-only in process-local state
@@ -29,6 +42,14 @@ extern "C" CUresult cuMemExportToShareableHandle(
             log_info("Exported handle 0x%llx as read-only FD %d",
                      (unsigned long long)handle, fd);
         }
+    } else if (result == CUDA_SUCCESS && handleType == CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR) {
+        // Read-write export that may still carry read-only granule ranges
+        std::vector<AccessRange> ranges;
+        size_t granularity;
+        WrapperState::getInstance().getReadOnlyRanges(handle, ranges, granularity);
+        if (!ranges.empty()) {
+            WrapperState::getInstance().markFdRanges(*(int*)shareableHandle, ranges, granularity);
+        }
     }
 
     return result;
@@ -39,19 +60,27 @@ extern "C" CUresult cuMemImportFromShareableHandle(
     void* osHandle,
     CUmemAllocationHandleType shHandleType) {
 
-    // Check if FD is marked as read-only (for POSIX FD type)
+    // Check if FD is marked as read-only, wholly or per range (for POSIX FD type)
     bool is_readonly = false;
+    std::vector<AccessRange> ro_ranges;
+    size_t granularity = 0;
     if (shHandleType == CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR) {
         int fd = (int)(intptr_t)osHandle;
-        is_readonly = WrapperState::getInstance().isFdReadOnly(fd);
+        is_readonly = WrapperState::getInstance().isFdReadOnly(fd, &ro_ranges, &granularity);
     }
 
     // Call real CUDA function
+    uint64_t trace_start = trace_begin();
     CUresult result = g_real_cuda.cuMemImportFromShareableHandle(handle, osHandle, shHandleType);
+    if (trace_start) {
+        trace_record(TRACE_MEM_IMPORT, trace_start, result,
+                     result == CUDA_SUCCESS ? *handle : 0, (uint64_t)(intptr_t)osHandle, shHandleType);
+    }
 
     if (result == CUDA_SUCCESS) {
         // Register the new handle (size unknown at import time, set to 0)
         WrapperState::getInstance().registerAllocation(*handle, 0);
+        WrapperState::getInstance().markImported(*handle, ro_ranges, granularity);
 
         // Propagate read-only status if FD was read-only
         if (is_readonly) {
@@ -1,6 +1,7 @@
 #define _GNU_SOURCE
 #include "cuda_ro_internal.h"
 #include "cuda_real_funcs.h"
+#include "cuda_ro_trace.h"
 #include <dlfcn.h>
 #include <cstdlib>
 #include <cstdio>
@@ -8,6 +9,24 @@
 // Global function pointers (definition)
 RealCudaFunctions g_real_cuda;
 
+// Stand-in for a symbol this driver does not export, so a wrapper that
+// forwards to it fails the call instead of jumping through a null pointer
+template <typename Fn> struct NotSupported;
+template <typename... Args> struct NotSupported<CUresult (*)(Args...)> {
+    static CUresult call(Args...) { return CUDA_ERROR_NOT_SUPPORTED; }
+};
+
+template <typename Fn>
+static bool loadSymbol(void* libcuda, const char* name, Fn& fn) {
+    fn = (Fn)dlsym(libcuda, name);
+    if (!fn) {
+        log_error("libcuda has no %s, calls to it fail with CUDA_ERROR_NOT_SUPPORTED", name);
+        fn = &NotSupported<Fn>::call;
+        return false;
+    }
+    return true;
+}
+
 // Constructor loads real symbols (runs when .so is loaded, before main())
 __attribute__((constructor))
 static void init_wrapper() {
@@ -22,30 +41,78 @@ static void init_wrapper() {
     }
 
     // Load CUDA VMM function pointers
-    g_real_cuda.cuInit = (cuInit_t)dlsym(libcuda, "cuInit");
-    g_real_cuda.cuMemCreate = (cuMemCreate_t)dlsym(libcuda, "cuMemCreate");
-    g_real_cuda.cuMemRelease = (cuMemRelease_t)dlsym(libcuda, "cuMemRelease");
-    g_real_cuda.cuMemMap = (cuMemMap_t)dlsym(libcuda, "cuMemMap");
-    g_real_cuda.cuMemUnmap = (cuMemUnmap_t)dlsym(libcuda, "cuMemUnmap");
-    g_real_cuda.cuMemSetAccess = (cuMemSetAccess_t)dlsym(libcuda, "cuMemSetAccess");
-    g_real_cuda.cuMemExportToShareableHandle = (cuMemExportToShareableHandle_t)dlsym(libcuda, "cuMemExportToShareableHandle");
-    g_real_cuda.cuMemImportFromShareableHandle = (cuMemImportFromShareableHandle_t)dlsym(libcuda, "cuMemImportFromShareableHandle");
-
-    if (!g_real_cuda.cuInit || !g_real_cuda.cuMemCreate) {
+    bool loaded = loadSymbol(libcuda, "cuInit", g_real_cuda.cuInit);
+    loaded = loadSymbol(libcuda, "cuMemCreate", g_real_cuda.cuMemCreate) && loaded;
+    loadSymbol(libcuda, "cuMemRelease", g_real_cuda.cuMemRelease);
+    loadSymbol(libcuda, "cuMemAddressReserve", g_real_cuda.cuMemAddressReserve);
+    loadSymbol(libcuda, "cuMemAddressFree", g_real_cuda.cuMemAddressFree);
+    loadSymbol(libcuda, "cuMemMap", g_real_cuda.cuMemMap);
+    loadSymbol(libcuda, "cuMemUnmap", g_real_cuda.cuMemUnmap);
+    loadSymbol(libcuda, "cuMemSetAccess", g_real_cuda.cuMemSetAccess);
+    loadSymbol(libcuda, "cuMemExportToShareableHandle", g_real_cuda.cuMemExportToShareableHandle);
+    loadSymbol(libcuda, "cuMemImportFromShareableHandle", g_real_cuda.cuMemImportFromShareableHandle);
+    loadSymbol(libcuda, "cuMemGetAllocationGranularity", g_real_cuda.cuMemGetAllocationGranularity);
+
+    // Copy/memset entry points (versioned driver symbol names)
+    loadSymbol(libcuda, "cuMemcpy", g_real_cuda.cuMemcpy);
+    loadSymbol(libcuda, "cuMemcpyAsync", g_real_cuda.cuMemcpyAsync);
+    loadSymbol(libcuda, "cuMemcpyHtoD_v2", g_real_cuda.cuMemcpyHtoD);
+    loadSymbol(libcuda, "cuMemcpyHtoDAsync_v2", g_real_cuda.cuMemcpyHtoDAsync);
+    loadSymbol(libcuda, "cuMemcpyDtoD_v2", g_real_cuda.cuMemcpyDtoD);
+    loadSymbol(libcuda, "cuMemcpyDtoDAsync_v2", g_real_cuda.cuMemcpyDtoDAsync);
+    loadSymbol(libcuda, "cuMemsetD8_v2", g_real_cuda.cuMemsetD8);
+    loadSymbol(libcuda, "cuMemsetD16_v2", g_real_cuda.cuMemsetD16);
+    loadSymbol(libcuda, "cuMemsetD32_v2", g_real_cuda.cuMemsetD32);
+    loadSymbol(libcuda, "cuMemsetD8Async", g_real_cuda.cuMemsetD8Async);
+    loadSymbol(libcuda, "cuMemsetD16Async", g_real_cuda.cuMemsetD16Async);
+    loadSymbol(libcuda, "cuMemsetD32Async", g_real_cuda.cuMemsetD32Async);
+    loadSymbol(libcuda, "cuMemsetD2D8_v2", g_real_cuda.cuMemsetD2D8);
+    loadSymbol(libcuda, "cuMemsetD2D16_v2", g_real_cuda.cuMemsetD2D16);
+    loadSymbol(libcuda, "cuMemsetD2D32_v2", g_real_cuda.cuMemsetD2D32);
+    loadSymbol(libcuda, "cuMemsetD2D8Async", g_real_cuda.cuMemsetD2D8Async);
+    loadSymbol(libcuda, "cuMemsetD2D16Async", g_real_cuda.cuMemsetD2D16Async);
+    loadSymbol(libcuda, "cuMemsetD2D32Async", g_real_cuda.cuMemsetD2D32Async);
+
+    // Per-thread default stream variants
+    loadSymbol(libcuda, "cuMemcpy_ptds", g_real_cuda.cuMemcpy_ptds);
+    loadSymbol(libcuda, "cuMemcpyAsync_ptsz", g_real_cuda.cuMemcpyAsync_ptsz);
+    loadSymbol(libcuda, "cuMemcpyHtoD_v2_ptds", g_real_cuda.cuMemcpyHtoD_ptds);
+    loadSymbol(libcuda, "cuMemcpyHtoDAsync_v2_ptsz", g_real_cuda.cuMemcpyHtoDAsync_ptsz);
+    loadSymbol(libcuda, "cuMemcpyDtoD_v2_ptds", g_real_cuda.cuMemcpyDtoD_ptds);
+    loadSymbol(libcuda, "cuMemcpyDtoDAsync_v2_ptsz", g_real_cuda.cuMemcpyDtoDAsync_ptsz);
+    loadSymbol(libcuda, "cuMemsetD8_v2_ptds", g_real_cuda.cuMemsetD8_ptds);
+    loadSymbol(libcuda, "cuMemsetD16_v2_ptds", g_real_cuda.cuMemsetD16_ptds);
+    loadSymbol(libcuda, "cuMemsetD32_v2_ptds", g_real_cuda.cuMemsetD32_ptds);
+    loadSymbol(libcuda, "cuMemsetD8Async_ptsz", g_real_cuda.cuMemsetD8Async_ptsz);
+    loadSymbol(libcuda, "cuMemsetD16Async_ptsz", g_real_cuda.cuMemsetD16Async_ptsz);
+    loadSymbol(libcuda, "cuMemsetD32Async_ptsz", g_real_cuda.cuMemsetD32Async_ptsz);
+    loadSymbol(libcuda, "cuMemsetD2D8_v2_ptds", g_real_cuda.cuMemsetD2D8_ptds);
+    loadSymbol(libcuda, "cuMemsetD2D16_v2_ptds", g_real_cuda.cuMemsetD2D16_ptds);
+    loadSymbol(libcuda, "cuMemsetD2D32_v2_ptds", g_real_cuda.cuMemsetD2D32_ptds);
+    loadSymbol(libcuda, "cuMemsetD2D8Async_ptsz", g_real_cuda.cuMemsetD2D8Async_ptsz);
+    loadSymbol(libcuda, "cuMemsetD2D16Async_ptsz", g_real_cuda.cuMemsetD2D16Async_ptsz);
+    loadSymbol(libcuda, "cuMemsetD2D32Async_ptsz", g_real_cuda.cuMemsetD2D32Async_ptsz);
+
+    if (!loaded) {
         fprintf(stderr, "ERROR: Failed to load CUDA symbols\n");
         abort();
     }
+
+    trace_init();
 }
 
 // Intercept cuInit to initialize shared memory
 extern "C" CUresult cuInit(unsigned int Flags) {
     // Call real CUDA init FIRST
+    uint64_t trace_start = trace_begin();
     CUresult result = g_real_cuda.cuInit(Flags);
+    if (trace_start) trace_record(TRACE_CU_INIT, trace_start, result, Flags);
 
     // Initialize shared memory exactly once on CUDA initialization
     static bool initialized = false;
     if (!initialized && result == CUDA_SUCCESS) {
         WrapperState::getInstance().initSharedMemory();
+        budget_init();
         initialized = true;
     }
 
@@ -55,5 +122,7 @@ extern "C" CUresult cuInit(unsigned int Flags) {
 // Destructor for cleanup
 __attribute__((destructor))
 static void cleanup_wrapper() {
+    trace_shutdown();
+    budget_shutdown();
     WrapperState::getInstance().cleanupSharedMemory();
 }
@@ -1,34 +1,86 @@
 #include "cuda_ro_internal.h"
 #include "cuda_real_funcs.h"
+#include "cuda_ro_trace.h"
 
 extern "C" CUresult cuMemCreate(CUmemGenericAllocationHandle* handle,
                                  size_t size,
                                  const CUmemAllocationProp* prop,
                                  unsigned long long flags) {
+    // Fail fast instead of letting the driver oversubscribe the GPU
+    if (!budget_charge(size)) {
+        return CUDA_ERROR_OUT_OF_MEMORY;
+    }
+
     // Call real function
+    uint64_t trace_start = trace_begin();
     CUresult result = g_real_cuda.cuMemCreate(handle, size, prop, flags);
+    if (trace_start) {
+        trace_record(TRACE_MEM_CREATE, trace_start, result,
+                     result == CUDA_SUCCESS ? *handle : 0, size, flags,
+                     prop ? prop->location.id : 0);
+    }
 
     if (result == CUDA_SUCCESS) {
-        // Register allocation (initially read-write)
-        WrapperState::getInstance().registerAllocation(*handle, size);
+        // Register allocation (initially read-write); the granularity bounds
+        // the per-range permissions the owner may set before exporting
+        size_t granularity = 0;
+        if (prop && g_real_cuda.cuMemGetAllocationGranularity) {
+            g_real_cuda.cuMemGetAllocationGranularity(&granularity, prop,
+                                                      CU_MEM_ALLOC_GRANULARITY_MINIMUM);
+        }
+        WrapperState::getInstance().registerAllocation(*handle, size, granularity);
+    } else {
+        budget_uncharge(size, false);
     }
 
     return result;
 }
 
 extern "C" CUresult cuMemRelease(CUmemGenericAllocationHandle handle) {
-    WrapperState::getInstance().unregisterAllocation(handle);
-    return g_real_cuda.cuMemRelease(handle);
+    AllocationMetadata meta;
+    bool known = WrapperState::getInstance().unregisterAllocation(handle, &meta);
+    uint64_t trace_start = trace_begin();
+    CUresult result = g_real_cuda.cuMemRelease(handle);
+    if (trace_start) trace_record(TRACE_MEM_RELEASE, trace_start, result, handle);
+
+    // Imported handles were registered with size 0 and were never charged
+    if (known && result == CUDA_SUCCESS) {
+        budget_uncharge(meta.size, meta.exported);
+    }
+    return result;
+}
+
+// Address reservation is passed straight through; intercepted for tracing
+extern "C" CUresult cuMemAddressReserve(CUdeviceptr* ptr, size_t size, size_t alignment,
+                                         CUdeviceptr addr, unsigned long long flags) {
+    uint64_t trace_start = trace_begin();
+    CUresult result = g_real_cuda.cuMemAddressReserve(ptr, size, alignment, addr, flags);
+    if (trace_start) {
+        trace_record(TRACE_MEM_ADDRESS_RESERVE, trace_start, result,
+                     result == CUDA_SUCCESS ? *ptr : 0, size, alignment, addr, flags);
+    }
+    return result;
+}
+
+extern "C" CUresult cuMemAddressFree(CUdeviceptr ptr, size_t size) {
+    uint64_t trace_start = trace_begin();
+    CUresult result = g_real_cuda.cuMemAddressFree(ptr, size);
+    if (trace_start) trace_record(TRACE_MEM_ADDRESS_FREE, trace_start, result, ptr, size);
+    return result;
 }
 
 extern "C" CUresult cuMemMap(CUdeviceptr ptr, size_t size, size_t offset,
                               CUmemGenericAllocationHandle handle,
                               unsigned long long flags) {
+    uint64_t trace_start = trace_begin();
     CUresult result = g_real_cuda.cuMemMap(ptr, size, offset, handle, flags);
+    if (trace_start) {
+        trace_record(TRACE_MEM_MAP, trace_start, result, ptr, size, offset, handle, flags);
+    }
 
     if (result == CUDA_SUCCESS) {
-        // Track ptr -> handle mapping for runtime checks
-        WrapperState::getInstance().registerMapping(ptr, handle, size);
+        // Track ptr -> (handle, offset) for runtime range checks
+        WrapperState::getInstance().registerMapping(ptr, handle, size, offset);
     }
 
     return result;
@@ -36,5 +88,8 @@ extern "C" CUresult cuMemMap(CUdeviceptr ptr, size_t size, size_t offset,
 
 extern "C" CUresult cuMemUnmap(CUdeviceptr ptr, size_t size) {
     WrapperState::getInstance().unregisterMapping(ptr);
-    return g_real_cuda.cuMemUnmap(ptr, size);
+    uint64_t trace_start = trace_begin();
+    CUresult result = g_real_cuda.cuMemUnmap(ptr, size);
+    if (trace_start) trace_record(TRACE_MEM_UNMAP, trace_start, result, ptr, size);
+    return result;
 }
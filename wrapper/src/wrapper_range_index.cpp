@@ -0,0 +1,94 @@
+#include "cuda_ro_internal.h"
+#include <sched.h>
+
+namespace {
+
+// The interval (read-only) or gap (writable) this thread's last lookup
+// landed in, valid while the index sequence is unchanged. Initial-exec TLS:
+// the wrapper is preloaded, so this is a plain %fs-relative load
+struct LastHit {
+    uint32_t seq;
+    bool read_only;
+    uint64_t lo;
+    uint64_t hi;
+};
+__attribute__((tls_model("initial-exec"))) thread_local LastHit t_last_hit = {1, false, 0, 0};
+
+}  // namespace
+
+ReadOnlyRangeIndex::ReadOnlyRangeIndex() : seq_(0), count_(0), overflowed_(false) {
+    for (size_t i = 0; i < CAPACITY; ++i) {
+        starts_[i].store(0, std::memory_order_relaxed);
+        ends_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void ReadOnlyRangeIndex::publish(const std::vector<AccessRange>& intervals) {
+    uint32_t seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    const size_t count = intervals.size() <= CAPACITY ? intervals.size() : 0;
+    for (size_t i = 0; i < count; ++i) {
+        starts_[i].store(intervals[i].offset, std::memory_order_relaxed);
+        ends_[i].store(intervals[i].offset + intervals[i].size, std::memory_order_relaxed);
+    }
+    count_.store((uint32_t)count, std::memory_order_relaxed);
+    overflowed_.store(intervals.size() > CAPACITY, std::memory_order_release);
+
+    seq_.store(seq + 2, std::memory_order_release);
+}
+
+ReadOnlyRangeIndex::Lookup ReadOnlyRangeIndex::overlaps(CUdeviceptr ptr, size_t size) const {
+    const uint64_t end = ptr + (size ? size : 1);
+    LastHit& last = t_last_hit;
+
+    for (;;) {
+        const uint32_t seq = seq_.load(std::memory_order_acquire);
+        if (seq == last.seq && ptr >= last.lo && end <= last.hi) {
+            return last.read_only ? BLOCKED : ALLOWED;
+        }
+        if (seq & 1) {
+            sched_yield();
+            continue;
+        }
+
+        // Read with the intervals, so it describes this snapshot
+        const bool overflowed = overflowed_.load(std::memory_order_relaxed);
+
+        // First interval ending after ptr
+        const uint32_t count = count_.load(std::memory_order_relaxed);
+        uint32_t lo = 0;
+        uint32_t hi = count;
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            if (ends_[mid].load(std::memory_order_relaxed) <= ptr) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        LastHit hit;
+        hit.seq = seq;
+        if (lo < count && starts_[lo].load(std::memory_order_relaxed) < end) {
+            hit.read_only = true;
+            hit.lo = starts_[lo].load(std::memory_order_relaxed);
+            hit.hi = ends_[lo].load(std::memory_order_relaxed);
+        } else {
+            hit.read_only = false;
+            hit.lo = lo > 0 ? ends_[lo - 1].load(std::memory_order_relaxed) : 0;
+            hit.hi = lo < count ? starts_[lo].load(std::memory_order_relaxed) : UINT64_MAX;
+        }
+
+        // Retry if a rebuild raced with the search
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (seq_.load(std::memory_order_relaxed) != seq) {
+            continue;
+        }
+        if (overflowed) {
+            return OVERFLOWED;
+        }
+        last = hit;
+        return hit.read_only ? BLOCKED : ALLOWED;
+    }
+}
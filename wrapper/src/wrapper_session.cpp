@@ -0,0 +1,22 @@
+#include "cuda_ro_internal.h"
+#include "cuda_ro_wrapper.h"
+
+// Exported for applications (looked up with dlsym, see cuda_ro_wrapper.h)
+
+extern "C" int cuRoWrapperGetRegistryFd(void) {
+    return WrapperState::getInstance().getRegistryFd();
+}
+
+extern "C" int cuRoWrapperAttachRegistry(int fd) {
+    return WrapperState::getInstance().attachRegistry(fd);
+}
+
+extern "C" int cuRoWrapperSetRangeAccess(CUmemGenericAllocationHandle handle, size_t offset,
+                                         size_t size, CUmemAccess_flags access) {
+    if (access != CU_MEM_ACCESS_FLAGS_PROT_READ && access != CU_MEM_ACCESS_FLAGS_PROT_READWRITE) {
+        log_error("Range access: unsupported access flags 0x%x", access);
+        return -1;
+    }
+    return WrapperState::getInstance().setRangeAccess(handle, offset, size,
+                                                      access == CU_MEM_ACCESS_FLAGS_PROT_READ);
+}
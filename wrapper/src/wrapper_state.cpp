@@ -3,6 +3,11 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <sched.h>
+#include <signal.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <cerrno>
 
@@ -19,50 +24,126 @@ WrapperState& WrapperState::getInstance() {
 }
 
 void WrapperState::initSharedMemory() {
-    // Open/create shared memory object
-    shm_fd_ = shm_open(SHM_NAME, O_CREAT | O_RDWR, 0666);
+    // Processes started with an inherited registry FD attach it up front
+    const char* env = getenv(REGISTRY_FD_ENV);
+    if (env && *env) {
+        attachRegistry(atoi(env));
+    }
+}
+
+// Create this process's session registry in a private memfd
+bool WrapperState::ensureSessionRegistry() {
+    if (shared_handle_map_) return true;
+
+    shm_fd_ = memfd_create("cuda_ro_wrapper_registry", MFD_CLOEXEC);
     if (shm_fd_ < 0) {
-        log_error("Failed to open shared memory: %s", strerror(errno));
-        return;
+        log_error("Failed to create registry memfd: %s", strerror(errno));
+        return false;
     }
 
-    // Set size
+    // Set size (zero-filled, so init_state starts UNINITIALIZED)
     if (ftruncate(shm_fd_, sizeof(SharedHandleMap)) < 0) {
-        log_error("Failed to resize shared memory");
-        return;
+        log_error("Failed to resize registry");
+        close(shm_fd_);
+        shm_fd_ = -1;
+        return false;
     }
 
     // Map into address space
-    shared_handle_map_ = (SharedHandleMap*)mmap(NULL, sizeof(SharedHandleMap),
+    void* addr = mmap(NULL, sizeof(SharedHandleMap),
         PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd_, 0);
-
-    if (shared_handle_map_ == MAP_FAILED) {
-        log_error("Failed to mmap shared memory");
-        shared_handle_map_ = nullptr;
-        return;
+    if (addr == MAP_FAILED) {
+        log_error("Failed to mmap registry");
+        close(shm_fd_);
+        shm_fd_ = -1;
+        return false;
     }
+    shared_handle_map_ = (SharedHandleMap*)addr;
 
-    // Initialize on first use (check if handle_count is zero)
-    int expected = 0;
-    if (shared_handle_map_->handle_count.compare_exchange_strong(expected, 0)) {
-        // First process to create the shared memory - initialize mutex
+    // Lock-free first-use initialization: only the CAS winner initializes
+    uint32_t expected = REGISTRY_UNINITIALIZED;
+    if (shared_handle_map_->init_state.compare_exchange_strong(expected, REGISTRY_INITIALIZING,
+            std::memory_order_acq_rel)) {
         pthread_mutexattr_t attr;
         pthread_mutexattr_init(&attr);
         pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
         pthread_mutex_init(&shared_handle_map_->lock, &attr);
         pthread_mutexattr_destroy(&attr);
 
-        // Initialize all entries
-        for (int i = 0; i < MAX_SHARED_HANDLES; i++) {
-            shared_handle_map_->entries[i].dev = 0;
-            shared_handle_map_->entries[i].ino = 0;
-            shared_handle_map_->entries[i].is_readonly.store(false);
-            shared_handle_map_->entries[i].owner_pid = 0;
+        shared_handle_map_->magic = SHARED_HANDLE_MAP_MAGIC;
+        shared_handle_map_->creator_pid = getpid();
+        shared_handle_map_->handle_count.store(0, std::memory_order_relaxed);
+        shared_handle_map_->init_state.store(REGISTRY_READY, std::memory_order_release);
+    }
+    return true;
+}
+
+int WrapperState::getRegistryFd() {
+    std::lock_guard<std::mutex> lock(registry_mutex_);
+    if (!ensureSessionRegistry()) return -1;
+
+    // Consumers get their own read-only open file description
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", shm_fd_);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        log_error("Failed to reopen registry read-only: %s", strerror(errno));
+    }
+    return fd;
+}
+
+int WrapperState::attachRegistry(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SharedHandleMap)) {
+        log_error("Rejected registry FD %d: not a wrapper registry", fd);
+        return -1;
+    }
+
+    std::lock_guard<std::mutex> lock(registry_mutex_);
+
+    // Our own registry, or one already attached: nothing to do
+    struct stat own;
+    if (shm_fd_ >= 0 && fstat(shm_fd_, &own) == 0 &&
+        own.st_dev == st.st_dev && own.st_ino == st.st_ino) {
+        return 0;
+    }
+    for (const AttachedRegistry& reg : attached_) {
+        if (reg.dev == st.st_dev && reg.ino == st.st_ino) {
+            return 0;
         }
     }
+
+    void* addr = mmap(NULL, sizeof(SharedHandleMap), PROT_READ, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        log_error("Failed to mmap registry FD %d: %s", fd, strerror(errno));
+        return -1;
+    }
+    const SharedHandleMap* map = (const SharedHandleMap*)addr;
+
+    // Creators publish READY before handing out FDs; tolerate a short race
+    for (int spins = 0; map->init_state.load(std::memory_order_acquire) != REGISTRY_READY; ++spins) {
+        if (spins > 100000) {
+            log_error("Registry FD %d never became ready", fd);
+            munmap(addr, sizeof(SharedHandleMap));
+            return -1;
+        }
+        sched_yield();
+    }
+    if (map->magic != SHARED_HANDLE_MAP_MAGIC) {
+        log_error("Registry FD %d has bad magic 0x%x", fd, map->magic);
+        munmap(addr, sizeof(SharedHandleMap));
+        return -1;
+    }
+
+    int own_fd = dup(fd);
+    attached_.push_back({own_fd, st.st_dev, st.st_ino, map});
+    log_info("Attached registry of pid %d (FD %d)", (int)map->creator_pid, fd);
+    return 0;
 }
 
 void WrapperState::cleanupSharedMemory() {
+    std::lock_guard<std::mutex> lock(registry_mutex_);
     if (shared_handle_map_) {
         munmap(shared_handle_map_, sizeof(SharedHandleMap));
         shared_handle_map_ = nullptr;
@@ -71,18 +152,129 @@ void WrapperState::cleanupSharedMemory() {
         close(shm_fd_);
         shm_fd_ = -1;
     }
-    // Note: Don't unlink shared memory here - other processes may still use it
-    // shm_unlink(SHM_NAME);
+    for (const AttachedRegistry& reg : attached_) {
+        munmap((void*)reg.map, sizeof(SharedHandleMap));
+        close(reg.fd);
+    }
+    attached_.clear();
 }
 
-void WrapperState::registerAllocation(CUmemGenericAllocationHandle handle, size_t size) {
+void WrapperState::registerAllocation(CUmemGenericAllocationHandle handle, size_t size,
+                                      size_t granularity) {
     std::lock_guard<std::mutex> lock(mutex_);
     AllocationMetadata meta;
     meta.handle = handle;
     meta.size = size;
     meta.is_read_only = false;
+    meta.exported = false;
     meta.exported_fd = -1;
-    allocations_[handle] = meta;
+    meta.imported = false;
+    meta.granularity = granularity;
+    allocations_[handle] = std::move(meta);
+}
+
+// Granule bitmaps: one bit per granule, tested a word at a time
+static void setGranuleBits(std::vector<uint64_t>& bits, size_t first, size_t last, bool value) {
+    if (bits.size() * 64 < last) {
+        bits.resize((last + 63) / 64, 0);
+    }
+    for (size_t i = first; i < last; ++i) {
+        if (value) {
+            bits[i / 64] |= 1ULL << (i % 64);
+        } else {
+            bits[i / 64] &= ~(1ULL << (i % 64));
+        }
+    }
+}
+
+static bool anyGranuleBit(const std::vector<uint64_t>& bits, size_t first, size_t last) {
+    last = std::min(last, bits.size() * 64);
+    while (first < last) {
+        size_t word = first / 64;
+        size_t shift = first % 64;
+        size_t span = std::min<size_t>(64 - shift, last - first);
+        uint64_t mask = (span == 64 ? ~0ULL : ((1ULL << span) - 1)) << shift;
+        if (bits[word] & mask) {
+            return true;
+        }
+        first += span;
+    }
+    return false;
+}
+
+int WrapperState::setRangeAccess(CUmemGenericAllocationHandle handle, size_t offset, size_t size,
+                                 bool read_only) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = allocations_.find(handle);
+    if (it == allocations_.end() || it->second.imported) {
+        log_error("Range access: handle 0x%llx is not an allocation this process created",
+                  (unsigned long long)handle);
+        return -1;
+    }
+    AllocationMetadata& meta = it->second;
+    if (meta.exported) {
+        log_error("Range access: handle 0x%llx is already exported; set ranges before exporting",
+                  (unsigned long long)handle);
+        return -1;
+    }
+    if (meta.granularity == 0 || offset % meta.granularity != 0 || size % meta.granularity != 0 ||
+        size == 0 || offset > meta.size || size > meta.size - offset) {
+        log_error("Range access: [0x%zx, +0x%zx) is not granularity (0x%zx) aligned inside "
+                  "the 0x%zx byte allocation", offset, size, meta.granularity, meta.size);
+        return -1;
+    }
+    setGranuleBits(meta.ro_granules, offset / meta.granularity,
+                   (offset + size) / meta.granularity, read_only);
+    log_info("Handle 0x%llx range [0x%zx, +0x%zx) exports %s", (unsigned long long)handle,
+             offset, size, read_only ? "read-only" : "read-write");
+    return 0;
+}
+
+void WrapperState::getReadOnlyRanges(CUmemGenericAllocationHandle handle,
+                                     std::vector<AccessRange>& ranges, size_t& granularity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ranges.clear();
+    granularity = 0;
+    auto it = allocations_.find(handle);
+    if (it == allocations_.end()) {
+        return;
+    }
+    const AllocationMetadata& meta = it->second;
+    granularity = meta.granularity;
+    const size_t granules = meta.ro_granules.size() * 64;
+    for (size_t i = 0; i < granules; ++i) {
+        if (!anyGranuleBit(meta.ro_granules, i, i + 1)) {
+            continue;
+        }
+        size_t end = i + 1;
+        while (end < granules && anyGranuleBit(meta.ro_granules, end, end + 1)) {
+            ++end;
+        }
+        ranges.push_back({i * meta.granularity, (end - i) * meta.granularity});
+        i = end;
+    }
+}
+
+void WrapperState::markImported(CUmemGenericAllocationHandle handle,
+                                const std::vector<AccessRange>& ranges, size_t granularity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = allocations_.find(handle);
+    if (it == allocations_.end()) {
+        return;
+    }
+    AllocationMetadata& meta = it->second;
+    meta.imported = true;
+    meta.granularity = granularity;
+    meta.ro_granules.clear();
+    if (granularity == 0) {
+        return;
+    }
+    // Round outwards: a partially covered granule is read-only
+    for (const AccessRange& range : ranges) {
+        setGranuleBits(meta.ro_granules, range.offset / granularity,
+                       (range.offset + range.size + granularity - 1) / granularity, true);
+    }
+    rebuildWriteIndex();
 }
 
 void WrapperState::markAsReadOnly(CUmemGenericAllocationHandle handle) {
@@ -90,12 +282,34 @@ void WrapperState::markAsReadOnly(CUmemGenericAllocationHandle handle) {
     auto it = allocations_.find(handle);
     if (it != allocations_.end()) {
         it->second.is_read_only = true;
+        rebuildWriteIndex();
     }
 }
 
-void WrapperState::unregisterAllocation(CUmemGenericAllocationHandle handle) {
+bool WrapperState::unregisterAllocation(CUmemGenericAllocationHandle handle,
+                                        AllocationMetadata* removed) {
     std::lock_guard<std::mutex> lock(mutex_);
-    allocations_.erase(handle);
+    auto it = allocations_.find(handle);
+    if (it == allocations_.end()) {
+        return false;
+    }
+    if (removed) {
+        *removed = it->second;
+    }
+    allocations_.erase(it);
+    rebuildWriteIndex();
+    return true;
+}
+
+size_t WrapperState::markExported(CUmemGenericAllocationHandle handle, int fd) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = allocations_.find(handle);
+    if (it == allocations_.end() || it->second.exported) {
+        return 0;
+    }
+    it->second.exported = true;
+    it->second.exported_fd = fd;
+    return it->second.size;
 }
 
 bool WrapperState::isHandleReadOnly(CUmemGenericAllocationHandle handle) {
@@ -107,8 +321,83 @@ bool WrapperState::isHandleReadOnly(CUmemGenericAllocationHandle handle) {
     return false;
 }
 
+int WrapperState::findEntry(const SharedHandleMap* map, dev_t dev, ino_t ino) {
+    int count = map->handle_count.load(std::memory_order_acquire);
+    for (int i = 0; i < count && i < MAX_SHARED_HANDLES; i++) {
+        const SharedHandleMap::HandleEntry& entry = map->entries[i];
+        if (entry.state.load(std::memory_order_acquire) == ENTRY_VALID &&
+            entry.dev == dev && entry.ino == ino) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Caller holds registry_mutex_ and the registry lock. New entries are
+// published only once fully written; nullptr when the registry is full
+SharedHandleMap::HandleEntry* WrapperState::addOrFindEntry(dev_t dev, ino_t ino, bool readonly) {
+    int existing = findEntry(shared_handle_map_, dev, ino);
+    if (existing >= 0) {
+        return &shared_handle_map_->entries[existing];
+    }
+    int idx = shared_handle_map_->handle_count.load(std::memory_order_relaxed);
+    if (idx >= MAX_SHARED_HANDLES) {
+        return nullptr;
+    }
+    SharedHandleMap::HandleEntry& entry = shared_handle_map_->entries[idx];
+    entry.state.store(ENTRY_WRITING, std::memory_order_relaxed);
+    entry.dev = dev;
+    entry.ino = ino;
+    entry.is_readonly.store(readonly, std::memory_order_relaxed);
+    entry.owner_pid = getpid();
+    entry.range_seq.store(0, std::memory_order_relaxed);
+    entry.range_writer_pid = 0;
+    entry.range_count = 0;
+    entry.granularity = 0;
+    entry.state.store(ENTRY_VALID, std::memory_order_release);
+    shared_handle_map_->handle_count.store(idx + 1, std::memory_order_release);
+    return &entry;
+}
+
+// Contended writers sleep in the kernel (futex) rather than spin. A writer
+// that died inside its critical section hands the next one EOWNERDEAD
+bool WrapperState::lockRegistry() {
+    int rc = pthread_mutex_lock(&shared_handle_map_->lock);
+    if (rc == EOWNERDEAD) {
+        log_error("Registry lock owner died, repairing registry");
+        repairRegistryLocked();
+        rc = pthread_mutex_consistent(&shared_handle_map_->lock);
+    }
+    if (rc != 0) {
+        log_error("Failed to lock registry: %s", strerror(rc));
+        return false;
+    }
+    return true;
+}
+
+// A dead writer can leave two things half-done: an entry past handle_count
+// (never published, so just cleared) and an odd range seqlock with partly
+// rewritten ranges. The latter fails safe to a wholly read-only handle
+void WrapperState::repairRegistryLocked() {
+    int count = shared_handle_map_->handle_count.load(std::memory_order_relaxed);
+    if (count < MAX_SHARED_HANDLES) {
+        shared_handle_map_->entries[count].state.store(ENTRY_EMPTY, std::memory_order_relaxed);
+    }
+    for (int i = 0; i < count && i < MAX_SHARED_HANDLES; i++) {
+        SharedHandleMap::HandleEntry& entry = shared_handle_map_->entries[i];
+        uint32_t seq = entry.range_seq.load(std::memory_order_relaxed);
+        if (!(seq & 1)) continue;
+        entry.is_readonly.store(true, std::memory_order_relaxed);
+        entry.range_count = 0;
+        entry.range_seq.store(seq + 1, std::memory_order_release);
+        log_error("Repaired half-written ranges of dev=%llu ino=%llu (now wholly read-only)",
+                  (unsigned long long)entry.dev, (unsigned long long)entry.ino);
+    }
+}
+
 void WrapperState::markFdAsReadOnly(int fd) {
-    if (!shared_handle_map_) return;
+    std::lock_guard<std::mutex> guard(registry_mutex_);
+    if (!ensureSessionRegistry()) return;
 
     // Get dev/ino for this FD using fstat
     struct stat st;
@@ -117,38 +406,57 @@ void WrapperState::markFdAsReadOnly(int fd) {
         return;
     }
 
-    pthread_mutex_lock(&shared_handle_map_->lock);
-
-    // Find if this dev/ino already exists
-    int count = shared_handle_map_->handle_count.load();
-    for (int i = 0; i < count && i < MAX_SHARED_HANDLES; i++) {
-        if (shared_handle_map_->entries[i].dev == st.st_dev &&
-            shared_handle_map_->entries[i].ino == st.st_ino) {
-            shared_handle_map_->entries[i].is_readonly.store(true);
-            pthread_mutex_unlock(&shared_handle_map_->lock);
-            log_info("Marked dev=%llu ino=%llu as read-only (FD %d)",
-                     (unsigned long long)st.st_dev, (unsigned long long)st.st_ino, fd);
-            return;
-        }
-    }
-
-    // Add new entry
-    int idx = shared_handle_map_->handle_count.fetch_add(1);
-    if (idx < MAX_SHARED_HANDLES) {
-        shared_handle_map_->entries[idx].dev = st.st_dev;
-        shared_handle_map_->entries[idx].ino = st.st_ino;
-        shared_handle_map_->entries[idx].is_readonly.store(true);
-        shared_handle_map_->entries[idx].owner_pid = getpid();
-        log_info("Added dev=%llu ino=%llu as read-only (FD %d)",
+    if (!lockRegistry()) return;
+    SharedHandleMap::HandleEntry* entry = addOrFindEntry(st.st_dev, st.st_ino, true);
+    if (entry) {
+        entry->is_readonly.store(true);
+        log_info("Marked dev=%llu ino=%llu as read-only (FD %d)",
                  (unsigned long long)st.st_dev, (unsigned long long)st.st_ino, fd);
+    } else {
+        log_error("Registry full, cannot mark FD %d read-only", fd);
     }
-
     pthread_mutex_unlock(&shared_handle_map_->lock);
 }
 
-bool WrapperState::isFdReadOnly(int fd) {
-    if (!shared_handle_map_) return false;
+void WrapperState::markFdRanges(int fd, const std::vector<AccessRange>& ranges,
+                                size_t granularity) {
+    // More ranges than an entry holds: fail safe to a wholly read-only export
+    if (ranges.size() > MAX_RO_RANGES) {
+        log_error("FD %d has %zu read-only ranges (max %d), exporting it wholly read-only",
+                  fd, ranges.size(), MAX_RO_RANGES);
+        markFdAsReadOnly(fd);
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(registry_mutex_);
+    if (!ensureSessionRegistry()) return;
 
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        log_error("fstat failed for FD %d: %s", fd, strerror(errno));
+        return;
+    }
+
+    if (!lockRegistry()) return;
+    SharedHandleMap::HandleEntry* entry = addOrFindEntry(st.st_dev, st.st_ino, false);
+    if (entry) {
+        uint32_t seq = entry->range_seq.load(std::memory_order_relaxed);
+        entry->range_writer_pid = getpid();
+        entry->range_seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        entry->granularity = granularity;
+        entry->range_count = (uint32_t)ranges.size();
+        std::copy(ranges.begin(), ranges.end(), entry->ranges);
+        entry->range_seq.store(seq + 2, std::memory_order_release);
+        log_info("Published %zu read-only ranges for dev=%llu ino=%llu (FD %d)", ranges.size(),
+                 (unsigned long long)st.st_dev, (unsigned long long)st.st_ino, fd);
+    } else {
+        log_error("Registry full, cannot publish ranges of FD %d", fd);
+    }
+    pthread_mutex_unlock(&shared_handle_map_->lock);
+}
+
+bool WrapperState::isFdReadOnly(int fd, std::vector<AccessRange>* ranges, size_t* granularity) {
     // Get dev/ino for this FD using fstat
     struct stat st;
     if (fstat(fd, &st) != 0) {
@@ -156,43 +464,158 @@ bool WrapperState::isFdReadOnly(int fd) {
         return false;
     }
 
-    pthread_mutex_lock(&shared_handle_map_->lock);
+    std::lock_guard<std::mutex> guard(registry_mutex_);
 
+    // Own session first (re-imports of our own exports), then producers'
     bool result = false;
-    int count = shared_handle_map_->handle_count.load();
-    for (int i = 0; i < count && i < MAX_SHARED_HANDLES; i++) {
-        if (shared_handle_map_->entries[i].dev == st.st_dev &&
-            shared_handle_map_->entries[i].ino == st.st_ino) {
-            result = shared_handle_map_->entries[i].is_readonly.load();
-            log_info("Checked dev=%llu ino=%llu (FD %d): is_readonly=%d",
-                     (unsigned long long)st.st_dev, (unsigned long long)st.st_ino, fd, result);
+    for (size_t r = 0; r <= attached_.size(); r++) {
+        const SharedHandleMap* map = r == 0 ? shared_handle_map_ : attached_[r - 1].map;
+        if (!map) continue;
+
+        int idx = findEntry(map, st.st_dev, st.st_ino);
+        if (idx >= 0) {
+            const SharedHandleMap::HandleEntry& entry = map->entries[idx];
+            result = entry.is_readonly.load();
+            if (ranges && granularity) {
+                // Seqlock read: retry while the owner is rewriting the ranges
+                uint32_t seq;
+                int spins = 0;
+                do {
+                    while ((seq = entry.range_seq.load(std::memory_order_acquire)) & 1) {
+                        // Writer died mid-rewrite and nobody has repaired
+                        // the entry yet: treat the handle as wholly read-only.
+                        // The pid is stored before the seq goes odd
+                        if (++spins > 1000 && kill(entry.range_writer_pid, 0) != 0 &&
+                            errno == ESRCH) {
+                            break;
+                        }
+                        sched_yield();
+                    }
+                    if (seq & 1) {
+                        result = true;
+                        ranges->clear();
+                        break;
+                    }
+                    uint32_t count = std::min<uint32_t>(entry.range_count, MAX_RO_RANGES);
+                    ranges->assign(entry.ranges, entry.ranges + count);
+                    *granularity = entry.granularity;
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                } while (entry.range_seq.load(std::memory_order_relaxed) != seq);
+            }
+            log_info("Checked dev=%llu ino=%llu (FD %d): is_readonly=%d, ro_ranges=%zu",
+                     (unsigned long long)st.st_dev, (unsigned long long)st.st_ino, fd, result,
+                     ranges ? ranges->size() : (size_t)0);
             break;
         }
     }
-
-    pthread_mutex_unlock(&shared_handle_map_->lock);
     return result;
 }
 
-void WrapperState::registerMapping(CUdeviceptr ptr, CUmemGenericAllocationHandle handle, size_t size) {
+void WrapperState::registerMapping(CUdeviceptr ptr, CUmemGenericAllocationHandle handle, size_t size,
+                                   size_t offset) {
     std::lock_guard<std::mutex> lock(mutex_);
-    ptr_to_handle_[ptr] = handle;
+    mappings_[ptr] = MappingInfo{handle, size, offset};
+    rebuildWriteIndex();
 }
 
 void WrapperState::unregisterMapping(CUdeviceptr ptr) {
     std::lock_guard<std::mutex> lock(mutex_);
-    ptr_to_handle_.erase(ptr);
+    if (mappings_.erase(ptr)) {
+        rebuildWriteIndex();
+    }
 }
 
-bool WrapperState::isDevicePtrReadOnly(CUdeviceptr ptr) {
+bool WrapperState::isDeviceRangeReadOnly(CUdeviceptr ptr, size_t size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return isRangeReadOnlyLocked(ptr, size, false);
+}
+
+bool WrapperState::isWriteBlocked(CUdeviceptr ptr, size_t size) {
+    const ReadOnlyRangeIndex::Lookup lookup = write_index_.overlaps(ptr, size);
+    if (lookup != ReadOnlyRangeIndex::OVERFLOWED) {
+        return lookup == ReadOnlyRangeIndex::BLOCKED;
+    }
     std::lock_guard<std::mutex> lock(mutex_);
-    auto it = ptr_to_handle_.find(ptr);
-    if (it != ptr_to_handle_.end()) {
-        CUmemGenericAllocationHandle handle = it->second;
-        auto alloc_it = allocations_.find(handle);
-        if (alloc_it != allocations_.end()) {
-            return alloc_it->second.is_read_only;
+    return isRangeReadOnlyLocked(ptr, size, true);
+}
+
+// imported_only skips handles this process created and exported read-only:
+// the owner may still fill them, only importers are held to read-only
+bool WrapperState::isRangeReadOnlyLocked(CUdeviceptr ptr, size_t size, bool imported_only) {
+    const CUdeviceptr end = ptr + (size ? size : 1);
+
+    // Every mapping overlapping [ptr, end), starting with the one containing ptr
+    auto it = mappings_.upper_bound(ptr);
+    if (it != mappings_.begin()) {
+        --it;
+    }
+    for (; it != mappings_.end() && it->first < end; ++it) {
+        const CUdeviceptr map_start = it->first;
+        const MappingInfo& mapping = it->second;
+        if (map_start + mapping.size <= ptr) {
+            continue;
+        }
+        auto alloc_it = allocations_.find(mapping.handle);
+        if (alloc_it == allocations_.end()) {
+            continue;
+        }
+        const AllocationMetadata& meta = alloc_it->second;
+        if (meta.is_read_only && (meta.imported || !imported_only)) {
+            return true;
+        }
+        if (!meta.imported || meta.ro_granules.empty()) {
+            continue;
+        }
+
+        // Granules of the handle behind the part of this mapping being touched
+        const CUdeviceptr lo = std::max(ptr, map_start);
+        const CUdeviceptr hi = std::min(end, map_start + mapping.size);
+        const size_t first = (mapping.offset + (lo - map_start)) / meta.granularity;
+        const size_t last = (mapping.offset + (hi - map_start) - 1) / meta.granularity + 1;
+        if (anyGranuleBit(meta.ro_granules, first, last)) {
+            return true;
         }
     }
     return false;
 }
+
+void WrapperState::rebuildWriteIndex() {
+    std::vector<AccessRange> intervals;
+    for (const auto& entry : mappings_) {
+        const CUdeviceptr map_start = entry.first;
+        const MappingInfo& mapping = entry.second;
+        auto alloc_it = allocations_.find(mapping.handle);
+        if (alloc_it == allocations_.end() || !alloc_it->second.imported) {
+            continue;
+        }
+        const AllocationMetadata& meta = alloc_it->second;
+
+        // Mappings are visited in VA order, so appending keeps the list sorted
+        auto add = [&intervals](uint64_t start, uint64_t size) {
+            if (!intervals.empty() && intervals.back().offset + intervals.back().size == start) {
+                intervals.back().size += size;
+            } else {
+                intervals.push_back({start, size});
+            }
+        };
+        if (meta.is_read_only) {
+            add(map_start, mapping.size);
+            continue;
+        }
+        if (meta.ro_granules.empty()) {
+            continue;
+        }
+        const size_t gran = meta.granularity;
+        const size_t first = mapping.offset / gran;
+        const size_t last = (mapping.offset + mapping.size + gran - 1) / gran;
+        for (size_t g = first; g < last; ++g) {
+            if (anyGranuleBit(meta.ro_granules, g, g + 1)) {
+                // Clip the granule to the mapped part of the handle
+                uint64_t lo = std::max<uint64_t>(g * gran, mapping.offset);
+                uint64_t hi = std::min<uint64_t>((g + 1) * gran, mapping.offset + mapping.size);
+                add(map_start + (lo - mapping.offset), hi - lo);
+            }
+        }
+    }
+    write_index_.publish(intervals);
+}
@@ -0,0 +1,141 @@
+#include "cuda_ro_internal.h"
+#include "cuda_ro_trace.h"
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+std::atomic<bool> g_trace_enabled(false);
+
+static int g_trace_fd = -1;
+static size_t g_trace_map_size = 0;
+static CuRoTraceHeader* g_trace_header = nullptr;
+static CuRoTraceRecord* g_trace_records = nullptr;
+
+// Per-thread chunk of the mapped file currently being filled
+struct TraceChunk {
+    uint64_t next;
+    uint64_t end;
+    uint32_t tid;
+};
+static thread_local TraceChunk t_chunk = {0, 0, 0};
+
+// A forked child shares the parent's mapping and inherits the forking
+// thread's chunk, so it would write the parent's record slots. It stops
+// tracing instead; an exec'd program traces to its own file again
+static void trace_atfork_child() {
+    g_trace_enabled.store(false, std::memory_order_relaxed);
+    t_chunk = {0, 0, 0};
+}
+
+uint64_t trace_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void trace_init() {
+    const char* prefix = getenv("CUDA_RO_WRAPPER_TRACE");
+    if (!prefix || !*prefix) return;
+
+    // One file per process: children inherit the variable, and sharing a
+    // path would truncate the first process's trace
+    const std::string path_string = std::string(prefix) + "." + std::to_string(getpid());
+    const char* path = path_string.c_str();
+
+    uint64_t capacity = 1 << 20;
+    const char* records_env = getenv("CUDA_RO_WRAPPER_TRACE_RECORDS");
+    if (records_env && *records_env) {
+        capacity = strtoull(records_env, NULL, 10);
+    }
+
+    g_trace_fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (g_trace_fd < 0) {
+        log_error("Failed to open trace file %s: %s", path, strerror(errno));
+        return;
+    }
+
+    g_trace_map_size = sizeof(CuRoTraceHeader) + capacity * sizeof(CuRoTraceRecord);
+    if (ftruncate(g_trace_fd, g_trace_map_size) < 0) {
+        log_error("Failed to size trace file: %s", strerror(errno));
+        close(g_trace_fd);
+        g_trace_fd = -1;
+        return;
+    }
+
+    void* addr = mmap(NULL, g_trace_map_size, PROT_READ | PROT_WRITE, MAP_SHARED, g_trace_fd, 0);
+    if (addr == MAP_FAILED) {
+        log_error("Failed to mmap trace file: %s", strerror(errno));
+        close(g_trace_fd);
+        g_trace_fd = -1;
+        return;
+    }
+
+    g_trace_header = (CuRoTraceHeader*)addr;
+    g_trace_records = (CuRoTraceRecord*)(g_trace_header + 1);
+    g_trace_header->magic = CU_RO_TRACE_MAGIC;
+    g_trace_header->version = CU_RO_TRACE_VERSION;
+    g_trace_header->record_size = sizeof(CuRoTraceRecord);
+    g_trace_header->capacity = capacity;
+    g_trace_header->next_record = 0;
+    g_trace_header->dropped = 0;
+    g_trace_header->start_ns = trace_now_ns();
+    g_trace_header->pid = getpid();
+    pthread_atfork(nullptr, nullptr, trace_atfork_child);
+    g_trace_enabled.store(true, std::memory_order_release);
+    log_info("Tracing VMM calls to %s (%llu records)", path, (unsigned long long)capacity);
+}
+
+void trace_shutdown() {
+    if (!g_trace_enabled.exchange(false)) return;
+    // Threads that passed the enabled check may still be writing records,
+    // so the mapping stays in place; the kernel drops it at exit
+    msync(g_trace_header, g_trace_map_size, MS_ASYNC);
+    close(g_trace_fd);
+    g_trace_fd = -1;
+}
+
+void trace_record(uint16_t call_id, uint64_t begin_ns, CUresult result,
+                  uint64_t a0, uint64_t a1, uint64_t a2, uint64_t a3, uint64_t a4) {
+    uint64_t end_ns = trace_now_ns();
+    if (!g_trace_enabled.load(std::memory_order_acquire)) return;
+
+    // Claim a new chunk when this thread's current one is used up
+    if (t_chunk.next == t_chunk.end) {
+        uint64_t start = __atomic_fetch_add(&g_trace_header->next_record,
+                                            CU_RO_TRACE_CHUNK, __ATOMIC_RELAXED);
+        if (start >= g_trace_header->capacity) {
+            __atomic_fetch_add(&g_trace_header->dropped, 1, __ATOMIC_RELAXED);
+            return;
+        }
+        t_chunk.next = start;
+        t_chunk.end = start + CU_RO_TRACE_CHUNK;
+        if (t_chunk.end > g_trace_header->capacity) {
+            t_chunk.end = g_trace_header->capacity;
+        }
+        if (t_chunk.tid == 0) {
+            t_chunk.tid = (uint32_t)syscall(SYS_gettid);
+        }
+    }
+
+    CuRoTraceRecord& record = g_trace_records[t_chunk.next++];
+    record.timestamp_ns = begin_ns;
+    record.duration_ns = end_ns - begin_ns;
+    record.tid = t_chunk.tid;
+    record.flags = 0;
+    record.result = result;
+    record.reserved = 0;
+    record.args[0] = a0;
+    record.args[1] = a1;
+    record.args[2] = a2;
+    record.args[3] = a3;
+    record.args[4] = a4;
+    // Written last so a reader never sees a half-filled record as valid
+    __atomic_store_n(&record.call_id, call_id, __ATOMIC_RELEASE);
+}
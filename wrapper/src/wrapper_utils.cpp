@@ -1,8 +1,21 @@
 #include "cuda_ro_internal.h"
 #include <cstdio>
 #include <cstdarg>
+#include <cstdlib>
+
+// CUDA_RO_WRAPPER_LOG=0 keeps only errors (default 1: info too)
+static bool infoEnabled() {
+    static const bool enabled = [] {
+        const char* env = getenv("CUDA_RO_WRAPPER_LOG");
+        return !env || atoi(env) > 0;
+    }();
+    return enabled;
+}
 
 void log_info(const char* format, ...) {
+    if (!infoEnabled()) {
+        return;
+    }
     va_list args;
     va_start(args, format);
     fprintf(stdout, "[CUDA-RO-WRAPPER] ");